@@ -0,0 +1,357 @@
+//-----------------------------------------------------------------------------
+/** @file analyze_tool/Main.cpp
+    Analyze the games in many SGF files with libpentobi_mcts::AnalyzeGame
+    and write the values of the positions in the main variations to a file.
+
+    Arguments are SGF files or directories, which are searched recursively
+    for files with extension .blksgf. The output file contains one line per
+    game. In CSV format, the line contains the file name, the game variant
+    and the values. In JSON format, the line contains an object with the
+    members "file", "variant" and "moves". Each move is an object with the
+    members "color", "move" and "value". The last element is the final
+    position, which has a null move. The values are the values of the
+    positions for the color of the move.
+
+    Files that already occur in the output file are skipped, so an
+    interrupted analysis can be continued by running the tool again with
+    the same arguments.
+
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include "libboardgame_base/Log.h"
+#include "libboardgame_base/Memory.h"
+#include "libboardgame_base/Options.h"
+#include "libboardgame_base/ThreadPool.h"
+#include "libboardgame_base/TreeReader.h"
+#include "libpentobi_base/PentobiTree.h"
+#include "libpentobi_mcts/AnalyzeGame.h"
+#include "libpentobi_mcts/Search.h"
+#include "libpentobi_mcts/Util.h"
+
+using namespace std;
+using libboardgame_base::Options;
+using libboardgame_base::SgfNode;
+using libboardgame_base::TaskGroup;
+using libboardgame_base::ThreadPool;
+using libboardgame_base::TreeReader;
+using libpentobi_base::BoardConst;
+using libpentobi_base::Game;
+using libpentobi_base::PentobiTree;
+using libpentobi_base::Variant;
+using libpentobi_mcts::AnalyzeGame;
+using libpentobi_mcts::Search;
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+struct Job
+{
+    string file;
+
+    unique_ptr<SgfNode> root;
+};
+
+string to_csv_string(const string& s)
+{
+    string result = "\"";
+    for (auto c : s)
+    {
+        if (c == '"')
+            result += '"';
+        result += c;
+    }
+    result += '"';
+    return result;
+}
+
+string to_json_string(const string& s)
+{
+    ostringstream result;
+    result << '"';
+    for (auto c : s)
+    {
+        if (c == '"' || c == '\\')
+            result << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            result << "\\u" << hex << setw(4) << setfill('0')
+                   << static_cast<unsigned>(c) << dec;
+        else
+            result << c;
+    }
+    result << '"';
+    return result.str();
+}
+
+/** Get the file name of a line in the output file.
+    @return The file name in the quoted form used in the output file or an
+    empty string if the line has an invalid format. */
+string get_quoted_file(const string& line, bool json)
+{
+    size_t begin = 0;
+    if (json)
+    {
+        const string prefix = "{\"file\":";
+        if (line.compare(0, prefix.size(), prefix) != 0)
+            return {};
+        begin = prefix.size();
+    }
+    if (begin >= line.size() || line[begin] != '"')
+        return {};
+    for (auto i = begin + 1; i < line.size(); ++i)
+    {
+        if (json && line[i] == '\\')
+            ++i;
+        else if (line[i] == '"')
+        {
+            if (! json && i + 1 < line.size() && line[i + 1] == '"')
+                ++i;
+            else
+                return line.substr(begin, i - begin + 1);
+        }
+    }
+    return {};
+}
+
+/** Get the files that are already in the output file.
+    An incomplete last line, which is left if the tool was interrupted while
+    writing, is removed from the file. */
+set<string> get_analyzed_files(const string& output_file, bool json)
+{
+    set<string> result;
+    ifstream in(output_file, ios::binary);
+    if (! in)
+        return result;
+    string line;
+    size_t complete_size = 0;
+    while (getline(in, line))
+    {
+        if (in.eof())
+            break;
+        complete_size += line.size() + 1;
+        auto file = get_quoted_file(line, json);
+        if (! file.empty())
+            result.insert(file);
+    }
+    in.close();
+    if (filesystem::file_size(output_file) != complete_size)
+    {
+        LIBBOARDGAME_LOG("Removing incomplete last line of ", output_file);
+        filesystem::resize_file(output_file, complete_size);
+    }
+    return result;
+}
+
+void find_files(const vector<string>& args, vector<string>& files)
+{
+    for (auto& arg : args)
+    {
+        if (! filesystem::is_directory(arg))
+        {
+            files.push_back(arg);
+            continue;
+        }
+        for (auto& entry : filesystem::recursive_directory_iterator(arg))
+            if (entry.is_regular_file()
+                    && entry.path().extension() == ".blksgf")
+                files.push_back(entry.path().string());
+    }
+    sort(files.begin(), files.end());
+    files.erase(unique(files.begin(), files.end()), files.end());
+}
+
+string format_result(const string& file, const AnalyzeGame& analyze_game,
+                     bool json)
+{
+    auto variant = analyze_game.get_variant();
+    auto& bc = BoardConst::get(variant);
+    ostringstream out;
+    out << setprecision(4);
+    if (json)
+    {
+        out << "{\"file\":" << to_json_string(file) << ",\"variant\":\""
+            << to_string_id(variant) << "\",\"moves\":[";
+        for (unsigned i = 0; i < analyze_game.get_nu_moves(); ++i)
+        {
+            if (i > 0)
+                out << ',';
+            auto mv = analyze_game.get_move(i);
+            out << "{\"color\":" << static_cast<unsigned>(mv.color.to_int())
+                << ",\"move\":";
+            if (mv.is_null())
+                out << "null";
+            else
+                out << '"' << bc.to_string(mv.move) << '"';
+            out << ",\"value\":" << analyze_game.get_value(i) << '}';
+        }
+        out << "]}";
+    }
+    else
+    {
+        out << to_csv_string(file) << ',' << to_string_id(variant);
+        for (unsigned i = 0; i < analyze_game.get_nu_moves(); ++i)
+            out << ',' << analyze_game.get_value(i);
+    }
+    return out.str();
+}
+
+size_t get_default_memory()
+{
+    auto available = libboardgame_base::get_memory();
+    if (available == 0)
+        available = 512000000;
+    return min(available / 4, size_t(2000000000));
+}
+
+void analyze(const vector<string>& args, const string& output_file,
+             bool json, unsigned nu_threads, size_t memory,
+             size_t nu_simulations)
+{
+    vector<string> files;
+    find_files(args, files);
+    auto analyzed_files = get_analyzed_files(output_file, json);
+    vector<Job> jobs;
+    vector<Variant> variants;
+    for (auto& file : files)
+    {
+        if (analyzed_files.count(json ? to_json_string(file)
+                                 : to_csv_string(file)) > 0)
+            continue;
+        try
+        {
+            ifstream in(file);
+            if (! in)
+                throw runtime_error("could not open file");
+            TreeReader reader;
+            reader.read(in);
+            auto root = reader.get_tree_transfer_ownership();
+            variants.push_back(PentobiTree::get_variant(*root));
+            jobs.push_back({file, move(root)});
+        }
+        catch (const exception& e)
+        {
+            LIBBOARDGAME_LOG("Skipping ", file, ": ", e.what());
+        }
+    }
+    LIBBOARDGAME_LOG("Analyzing ", jobs.size(), " of ", files.size(),
+                     " files");
+    if (jobs.empty())
+        return;
+    BoardConst::preload(variants);
+    if (nu_threads == 0)
+        nu_threads = libpentobi_mcts::get_nu_threads();
+    nu_threads = static_cast<unsigned>(min(size_t(nu_threads), jobs.size()));
+    ofstream out(output_file, ios::app);
+    if (! out)
+        throw runtime_error("could not open " + output_file);
+    // Several games are analyzed concurrently, each with a single-threaded
+    // search, which scales better than analyzing one game at a time with a
+    // multi-threaded search and still reuses the subtree of the previous
+    // position within a game
+    auto variant = PentobiTree::get_variant(*jobs[0].root);
+    vector<unique_ptr<Search>> searches;
+    for (unsigned i = 0; i < nu_threads; ++i)
+        searches.push_back(make_unique<Search>(variant, 1,
+                                               memory / nu_threads));
+    atomic<size_t> next_job(0);
+    size_t nu_finished = 0;
+    mutex out_mutex;
+    ThreadPool pool(nu_threads);
+    TaskGroup group(pool);
+    for (auto& search : searches)
+        group.run([&, &search = *search]
+        {
+            while (true)
+            {
+                auto i = next_job.fetch_add(1);
+                if (i >= jobs.size())
+                    break;
+                auto& job = jobs[i];
+                string line;
+                try
+                {
+                    // A new AnalyzeGame per game, such that the values of
+                    // positions cached in earlier games do not make the
+                    // results depend on the order in which the workers take
+                    // the jobs
+                    AnalyzeGame analyze_game;
+                    Game game(PentobiTree::get_variant(*job.root));
+                    game.init(job.root);
+                    analyze_game.run(game, search, nu_simulations,
+                                     [](unsigned, unsigned) { });
+                    line = format_result(job.file, analyze_game, json);
+                }
+                catch (const exception& e)
+                {
+                    LIBBOARDGAME_LOG("Skipping ", job.file, ": ", e.what());
+                }
+                lock_guard lock(out_mutex);
+                ++nu_finished;
+                if (! line.empty())
+                {
+                    out << line << '\n' << flush;
+                    if (! out)
+                        throw runtime_error("could not write "
+                                            + output_file);
+                }
+                LIBBOARDGAME_LOG("Finished ", nu_finished, "/", jobs.size(),
+                                 ": ", job.file);
+            }
+        });
+    group.wait();
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    libboardgame_base::LogInitializer log_initializer;
+    try
+    {
+        vector<string> specs = {
+            "json",
+            "memory:",
+            "output|o:",
+            "quiet",
+            "simulations|s:",
+            "threads:",
+        };
+        Options opt(argc, argv, specs);
+        if (opt.get_args().empty())
+            throw runtime_error("Need SGF files or directories as arguments");
+        bool json = opt.contains("json");
+        auto output_file = opt.get("output", json ? "analysis.jsonl"
+                                                  : "analysis.csv");
+        auto nu_threads = opt.get<unsigned>("threads", 0);
+        size_t memory;
+        if (opt.contains("memory"))
+            memory = opt.get<size_t>("memory") * 1000000;
+        else
+            memory = get_default_memory();
+        auto nu_simulations = opt.get<size_t>("simulations", 3000);
+        if (nu_simulations == 0)
+            throw runtime_error("Number of simulations must be positive");
+        if (opt.contains("quiet"))
+            libboardgame_base::disable_logging();
+        analyze(opt.get_args(), output_file, json, nu_threads, memory,
+                nu_simulations);
+    }
+    catch (const exception& e)
+    {
+        LIBBOARDGAME_LOG("Error: ", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
@@ -12,6 +12,7 @@
 #include "libboardgame_base/FmtSaver.h"
 #include "libboardgame_base/Log.h"
 #include "libboardgame_base/Options.h"
+#include "libboardgame_base/ThreadPool.h"
 #include "libboardgame_base/TreeReader.h"
 #include "libpentobi_base/Game.h"
 #include "libpentobi_base/MoveMarker.h"
@@ -21,6 +22,7 @@ using namespace std;
 using libboardgame_base::split;
 using libboardgame_base::FmtSaver;
 using libboardgame_base::Options;
+using libboardgame_base::TaskGroup;
 using libboardgame_base::TreeReader;
 using libpentobi_base::Board;
 using libpentobi_base::BoardConst;
@@ -121,8 +123,6 @@ random_device rand_dev;
 
 mt19937 rand_gen(rand_dev());
 
-vector<Float> probs;
-
 array<Float, _nu_features> weights;
 
 array<Float, _nu_features> grad_weights;
@@ -414,15 +414,16 @@ void init_weights()
         w = distribution(rand_gen);
 }
 
-/** Gradient descent step using softmax training. */
-void train_step(unsigned step, bool print)
+/** Add the gradient of the softmax cost of a range of samples.
+    @return The cost of the samples. */
+Float add_gradient(size_t begin, size_t end,
+                   array<Float, _nu_features>& gradient)
 {
-    for (auto& w : grad_weights)
-        w = 0;
-
+    vector<Float> probs;
     Float cost = 0;
-    for (auto& sample : samples)
+    for (auto k = begin; k < end; ++k)
     {
+        auto& sample = samples[k];
         auto nu_moves = sample.features.size();
         probs.resize(nu_moves);
         Float sum = 0;
@@ -444,16 +445,46 @@ void train_step(unsigned step, bool print)
             if (i == sample.played_move)
             {
                 for (unsigned j = 0; j < _nu_features; ++j)
-                    grad_weights[j] -= (1 - p) * feature[j];
+                    gradient[j] -= (1 - p) * feature[j];
             }
             else
             {
                 for (unsigned j = 0; j < _nu_features; ++j)
-                    grad_weights[j] -= (-p) * feature[j];
+                    gradient[j] -= (-p) * feature[j];
             }
         }
         cost += -log(probs[sample.played_move]);
     }
+    return cost;
+}
+
+/** Gradient descent step using softmax training.
+    The gradient is computed in parallel for a fixed number of chunks of the
+    samples, such that the result does not depend on the number of threads. */
+void train_step(unsigned step, bool print)
+{
+    const size_t nu_chunks = 64;
+    vector<array<Float, _nu_features>> gradients(nu_chunks);
+    vector<Float> costs(nu_chunks);
+    auto nu_samples_total = samples.size();
+    TaskGroup group;
+    for (size_t i = 0; i < nu_chunks; ++i)
+        group.run([&, i]
+        {
+            gradients[i].fill(0);
+            costs[i] = add_gradient(i * nu_samples_total / nu_chunks,
+                                    (i + 1) * nu_samples_total / nu_chunks,
+                                    gradients[i]);
+        });
+    group.wait();
+    Float cost = 0;
+    grad_weights.fill(0);
+    for (size_t i = 0; i < nu_chunks; ++i)
+    {
+        for (unsigned j = 0; j < _nu_features; ++j)
+            grad_weights[j] += gradients[i][j];
+        cost += costs[i];
+    }
 
     auto nu_samples = static_cast<Float>(samples.size());
     Float decay = 1e-3;
@@ -6,15 +6,326 @@
 
 #include "Memory.h"
 
-#ifdef _WIN32
 #include <algorithm>
+#include <fstream>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "StringUtil.h"
+
+#ifdef _WIN32
 #include <windows.h>
 #else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 namespace libboardgame_base {
 
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+#ifdef __linux__
+
+/** Parse a list in the format used by Linux in sysfs (e.g. "0-3,8,10-11"). */
+vector<int> parse_cpu_list(const string& s)
+{
+    vector<int> result;
+    for (auto& i : split(s, ','))
+    {
+        auto range = split(i, '-');
+        int first;
+        int last;
+        if (range.empty() || ! from_string(range[0], first))
+            continue;
+        if (range.size() < 2 || ! from_string(range[1], last))
+            last = first;
+        for (int j = first; j <= last; ++j)
+            result.push_back(j);
+    }
+    return result;
+}
+
+string read_sysfs_line(const string& file)
+{
+    ifstream in(file);
+    string line;
+    getline(in, line);
+    return trim(line);
+}
+
+/** Get the CPUs that the process may use ordered by NUMA node. */
+vector<int> get_cpus_by_numa_node()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return {};
+    vector<int> result;
+    auto add = [&](int cpu) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)
+                && find(result.begin(), result.end(), cpu) == result.end())
+            result.push_back(cpu);
+    };
+    const string dir = "/sys/devices/system/node/";
+    for (auto node : parse_cpu_list(read_sysfs_line(dir + "online")))
+        for (auto cpu : parse_cpu_list(
+                 read_sysfs_line(dir + "node" + to_string(node)
+                                 + "/cpulist")))
+            add(cpu);
+    // Add remaining CPUs if the NUMA information is not available
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        add(cpu);
+    return result;
+}
+
+#endif // __linux__
+
+size_t get_system_page_size()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    return page_size > 0 ? static_cast<size_t>(page_size) : 4096;
+#endif
+}
+
+#ifndef _WIN32
+
+/** Get the default huge page size of the system.
+    @return The size or 0 if huge pages are not supported. */
+size_t get_huge_page_size()
+{
+#ifdef __linux__
+    ifstream in("/proc/meminfo");
+    string line;
+    while (getline(in, line))
+    {
+        if (line.compare(0, 13, "Hugepagesize:") != 0)
+            continue;
+        size_t kb;
+        if (from_string(trim(line.substr(13, line.find("kB") - 13)), kb))
+            return kb * 1024;
+    }
+    return 2 * 1024 * 1024;
+#else
+    return 0;
+#endif
+}
+
+#endif // ! _WIN32
+
+size_t round_up(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+PageMemory::PageMemory(size_t size, bool huge_pages)
+{
+    if (size == 0)
+        size = 1;
+#ifdef _WIN32
+
+    if (huge_pages)
+    {
+        // Needs the SeLockMemoryPrivilege, usually not available
+        size_t large_page_size = GetLargePageMinimum();
+        if (large_page_size > 0)
+        {
+            m_mapping_size = round_up(size, large_page_size);
+            m_mapping = VirtualAlloc(nullptr, m_mapping_size,
+                                     MEM_RESERVE | MEM_COMMIT
+                                     | MEM_LARGE_PAGES, PAGE_READWRITE);
+            m_page_size = large_page_size;
+        }
+    }
+    if (m_mapping == nullptr)
+    {
+        m_page_size = get_system_page_size();
+        m_mapping_size = round_up(size, m_page_size);
+        m_mapping = VirtualAlloc(nullptr, m_mapping_size,
+                                 MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    }
+    if (m_mapping == nullptr)
+        throw bad_alloc();
+    m_ptr = m_mapping;
+
+#else
+
+    size_t huge_page_size = (huge_pages ? get_huge_page_size() : 0);
+#ifdef MAP_HUGETLB
+    if (huge_page_size > 0)
+    {
+        m_mapping_size = round_up(size, huge_page_size);
+        m_mapping = mmap(nullptr, m_mapping_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (m_mapping == MAP_FAILED)
+            m_mapping = nullptr;
+        else
+        {
+            m_ptr = m_mapping;
+            m_page_size = huge_page_size;
+            return;
+        }
+    }
+#endif
+    m_page_size = get_system_page_size();
+    // Align to huge pages in case transparent huge pages can be used
+    auto alignment = max(huge_page_size, m_page_size);
+    m_mapping_size = round_up(size, m_page_size) + alignment - m_page_size;
+    m_mapping = mmap(nullptr, m_mapping_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m_mapping == MAP_FAILED)
+    {
+        m_mapping = nullptr;
+        throw bad_alloc();
+    }
+    auto addr = reinterpret_cast<uintptr_t>(m_mapping);
+    m_ptr = reinterpret_cast<void*>(round_up(addr, alignment));
+#ifdef MADV_HUGEPAGE
+    if (huge_page_size > 0
+            && madvise(m_ptr, round_up(size, huge_page_size),
+                       MADV_HUGEPAGE) == 0)
+        m_page_size = huge_page_size;
+#endif
+
+#endif
+}
+
+PageMemory::PageMemory(const string& file, size_t offset, size_t size)
+{
+    if (offset % file_alignment != 0)
+        throw runtime_error("invalid file offset");
+    if (size == 0)
+        size = 1;
+#ifdef _WIN32
+
+    HANDLE handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                                nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        throw runtime_error("could not open " + file);
+    LARGE_INTEGER file_size;
+    if (! GetFileSizeEx(handle, &file_size)
+            || static_cast<uint64_t>(file_size.QuadPart) < offset + size)
+    {
+        CloseHandle(handle);
+        throw runtime_error("file too short: " + file);
+    }
+    HANDLE file_mapping = CreateFileMappingA(handle, nullptr, PAGE_WRITECOPY,
+                                             0, 0, nullptr);
+    CloseHandle(handle);
+    if (file_mapping == nullptr)
+        throw runtime_error("could not map " + file);
+    auto offset_64 = static_cast<uint64_t>(offset);
+    m_mapping = MapViewOfFile(file_mapping, FILE_MAP_COPY,
+                              static_cast<DWORD>(offset_64 >> 32),
+                              static_cast<DWORD>(offset_64 & 0xffffffff),
+                              size);
+    // The view keeps a reference to the file mapping
+    CloseHandle(file_mapping);
+    if (m_mapping == nullptr)
+        throw runtime_error("could not map " + file);
+    m_is_file = true;
+
+#else
+
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw runtime_error("could not open " + file);
+    // Accessing a mapping beyond the end of the file would raise SIGBUS
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < offset + size)
+    {
+        close(fd);
+        throw runtime_error("file too short: " + file);
+    }
+    m_mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                     static_cast<off_t>(offset));
+    close(fd);
+    if (m_mapping == MAP_FAILED)
+    {
+        m_mapping = nullptr;
+        throw runtime_error("could not map " + file);
+    }
+
+#endif
+    m_mapping_size = size;
+    m_ptr = m_mapping;
+    m_page_size = get_system_page_size();
+}
+
+PageMemory::PageMemory(PageMemory&& memory) noexcept
+    : m_ptr(memory.m_ptr),
+      m_mapping(memory.m_mapping),
+      m_mapping_size(memory.m_mapping_size),
+      m_page_size(memory.m_page_size)
+#ifdef _WIN32
+      , m_is_file(memory.m_is_file)
+#endif
+{
+    memory.m_ptr = nullptr;
+    memory.m_mapping = nullptr;
+    memory.m_mapping_size = 0;
+}
+
+PageMemory::~PageMemory()
+{
+    free();
+}
+
+void PageMemory::free()
+{
+    if (m_mapping == nullptr)
+        return;
+#ifdef _WIN32
+    if (m_is_file)
+        UnmapViewOfFile(m_mapping);
+    else
+        VirtualFree(m_mapping, 0, MEM_RELEASE);
+#else
+    munmap(m_mapping, m_mapping_size);
+#endif
+    m_ptr = nullptr;
+    m_mapping = nullptr;
+    m_mapping_size = 0;
+}
+
+PageMemory& PageMemory::operator=(PageMemory&& memory) noexcept
+{
+    if (this != &memory)
+    {
+        free();
+        swap(m_ptr, memory.m_ptr);
+        swap(m_mapping, memory.m_mapping);
+        swap(m_mapping_size, memory.m_mapping_size);
+        m_page_size = memory.m_page_size;
+#ifdef _WIN32
+        m_is_file = memory.m_is_file;
+#endif
+    }
+    return *this;
+}
+
 //-----------------------------------------------------------------------------
 
 size_t get_memory()
@@ -46,6 +357,34 @@ size_t get_memory()
 #endif
 }
 
+bool pin_thread_to_cpu([[maybe_unused]] unsigned i)
+{
+#ifdef __linux__
+
+    static const auto cpus = get_cpus_by_numa_node();
+    if (cpus.empty())
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[i % cpus.size()], &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+
+#else
+
+    return false;
+
+#endif
+}
+
+void touch_memory(void* p, size_t size)
+{
+    auto page_size = get_system_page_size();
+    auto begin = static_cast<volatile char*>(p);
+    auto end = begin + size;
+    for (auto i = begin; i < end; i += page_size)
+        *i = *i;
+}
+
 //-----------------------------------------------------------------------------
 
 } // namespace libboardgame_base
@@ -8,15 +8,97 @@
 #define LIBBOARDGAME_BASE_MEMORY_H
 
 #include <cstddef>
+#include <string>
 
 namespace libboardgame_base {
 
 //-----------------------------------------------------------------------------
 
+/** Large memory block allocated directly from the operating system.
+    The memory is zero-initialized and its pages are not used before the
+    first access, which allows placing them with touch_memory(). Optionally,
+    the block can be backed by huge pages to reduce TLB misses when accessing
+    it randomly. Explicit huge pages are tried first, then transparent huge
+    pages, then normal pages.<p>
+    Alternatively, the block can be a copy-on-write mapping of a part of a
+    file, which makes the content of the file available without reading it
+    in advance. */
+class PageMemory
+{
+public:
+    /** Alignment required for the offset of file mappings.
+        This is the allocation granularity on Windows, which is a multiple
+        of the page size on all supported platforms. */
+    static constexpr std::size_t file_alignment = 65536;
+
+    PageMemory() = default;
+
+    /** Constructor.
+        @param size The size in bytes.
+        @param huge_pages Try to use huge pages.
+        @throws std::bad_alloc */
+    PageMemory(std::size_t size, bool huge_pages);
+
+    /** Constructor for mapping a part of a file.
+        Modifications of the memory are private and not written to the file.
+        @param file The file name.
+        @param offset The start of the part in the file. Must be a multiple of
+        file_alignment.
+        @param size The size of the part in bytes.
+        @throws std::runtime_error If the file cannot be opened or is too
+        short. */
+    PageMemory(const std::string& file, std::size_t offset, std::size_t size);
+
+    ~PageMemory();
+
+    PageMemory(PageMemory&& memory) noexcept;
+
+    PageMemory& operator=(PageMemory&& memory) noexcept;
+
+    void* get() const { return m_ptr; }
+
+    /** The page size backing the memory.
+        In the case of transparent huge pages, this is the huge page size
+        although the operating system does not guarantee that all pages are
+        huge pages. */
+    std::size_t get_page_size() const { return m_page_size; }
+
+private:
+    void* m_ptr = nullptr;
+
+    void* m_mapping = nullptr;
+
+    std::size_t m_mapping_size = 0;
+
+    std::size_t m_page_size = 0;
+
+#ifdef _WIN32
+    bool m_is_file = false;
+#endif
+
+    void free();
+};
+
+//-----------------------------------------------------------------------------
+
 /** Get the physical memory available on the system.
     @return The memory in bytes or 0 if the memory could not be determined. */
 std::size_t get_memory();
 
+/** Pin the current thread to a CPU.
+    The CPUs available to the process are ordered by NUMA node, so that
+    consecutive indices use CPUs on the same node as long as possible.
+    @param i The index of the CPU (modulo the number of available CPUs).
+    @return false if thread pinning is not supported on this platform. */
+bool pin_thread_to_cpu(unsigned i);
+
+/** Touch the pages of a memory region from the current thread.
+    With the first-touch policy of the operating system, this places memory
+    that has not yet been used on the NUMA node of the current thread. The
+    content of the memory is not changed, but the function is not thread-safe
+    and may not be used while other threads write to the memory. */
+void touch_memory(void* p, std::size_t size);
+
 //-----------------------------------------------------------------------------
 
 } // namespace libboardgame_base
@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------------
+/** @file libboardgame_base/ParkingFlag.cpp
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include "ParkingFlag.h"
+
+#include <chrono>
+#include <thread>
+
+namespace libboardgame_base {
+
+//-----------------------------------------------------------------------------
+
+ParkingFlag::ParkingFlag(double spin_time)
+    : m_spin_time(spin_time)
+{
+}
+
+void ParkingFlag::set()
+{
+    // Both the store and the load need sequential consistency: either
+    // wait() sees the flag before it blocks or this function sees that
+    // wait() is blocked or about to block
+    m_flag.store(true);
+    if (m_is_parked.load())
+    {
+        {
+            lock_guard lock(m_mutex);
+        }
+        m_cond.notify_one();
+    }
+}
+
+/** Spin until the flag is set or the spin time is exceeded.
+    Yields the processor regularly, so that spinning does not delay the
+    setting thread if both run on the same CPU. */
+bool ParkingFlag::spin()
+{
+    using Clock = chrono::steady_clock;
+    auto end = Clock::now() + chrono::duration<double>(m_spin_time);
+    for (unsigned i = 1; ; ++i)
+    {
+        if (m_flag.load(memory_order_acquire))
+            return true;
+        if (i % 64 == 0)
+        {
+            if (Clock::now() > end)
+                return false;
+            this_thread::yield();
+        }
+    }
+}
+
+void ParkingFlag::wait()
+{
+    if (! spin())
+    {
+        unique_lock lock(m_mutex);
+        m_is_parked.store(true);
+        while (! m_flag.load())
+            m_cond.wait(lock);
+        m_is_parked.store(false);
+    }
+    m_flag.store(false, memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+
+} // namespace libboardgame_base
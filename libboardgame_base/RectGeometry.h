@@ -9,6 +9,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include "Geometry.h"
 
 namespace libboardgame_base {
@@ -61,6 +62,9 @@ template<class P>
 const RectGeometry<P>& RectGeometry<P>::get(unsigned width, unsigned height)
 {
     static map<pair<unsigned, unsigned>, shared_ptr<RectGeometry>> s_geometry;
+    static mutex s_mutex;
+
+    lock_guard lock(s_mutex);
 
     pair key(width, height);
     auto pos = s_geometry.find(key);
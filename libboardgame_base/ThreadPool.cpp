@@ -0,0 +1,198 @@
+//-----------------------------------------------------------------------------
+/** @file libboardgame_base/ThreadPool.cpp
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include "ThreadPool.h"
+
+#include "Assert.h"
+
+namespace libboardgame_base {
+
+//-----------------------------------------------------------------------------
+
+thread_local const ThreadPool* ThreadPool::s_current_pool = nullptr;
+
+thread_local unsigned ThreadPool::s_current_index = 0;
+
+ThreadPool::ThreadPool(unsigned nu_threads)
+{
+    if (nu_threads == 0)
+        nu_threads = max(thread::hardware_concurrency(), 1u);
+    m_queues.reserve(nu_threads);
+    for (unsigned i = 0; i < nu_threads; ++i)
+        m_queues.push_back(make_unique<Queue>());
+    m_threads.reserve(nu_threads);
+    for (unsigned i = 0; i < nu_threads; ++i)
+        m_threads.emplace_back(&ThreadPool::thread_main, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard lock(m_mutex);
+        m_quit = true;
+    }
+    m_cond.notify_all();
+    for (auto& t : m_threads)
+        t.join();
+}
+
+ThreadPool& ThreadPool::get_global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+bool ThreadPool::run_pending_task()
+{
+    return try_run(s_current_pool == this ? s_current_index : 0);
+}
+
+void ThreadPool::submit(Task task)
+{
+    auto nu_queues = static_cast<unsigned>(m_queues.size());
+    unsigned index;
+    if (s_current_pool == this)
+        index = s_current_index;
+    else
+        index = m_next_queue.fetch_add(1, memory_order_relaxed) % nu_queues;
+    auto& queue = *m_queues[index];
+    {
+        // Increment the counter before the task can be taken by a worker,
+        // which decrements it after taking it, otherwise the counter could
+        // wrap around
+        lock_guard lock(queue.queue_mutex);
+        m_nu_pending.fetch_add(1);
+        queue.tasks.push_back(move(task));
+    }
+    // Taking the lock avoids that a worker misses the notification between
+    // checking m_nu_pending and starting to wait
+    {
+        lock_guard lock(m_mutex);
+    }
+    m_cond.notify_one();
+}
+
+void ThreadPool::thread_main(unsigned index)
+{
+    s_current_pool = this;
+    s_current_index = index;
+    while (true)
+    {
+        if (try_run(index))
+            continue;
+        unique_lock lock(m_mutex);
+        while (! m_quit && m_nu_pending.load() == 0)
+            m_cond.wait(lock);
+        if (m_quit && m_nu_pending.load() == 0)
+            break;
+    }
+}
+
+/** Execute a task from the queue with the given index or, if it is empty,
+    steal one from another queue. */
+bool ThreadPool::try_run(unsigned index)
+{
+    if (m_nu_pending.load() == 0)
+        return false;
+    Task task;
+    {
+        auto& queue = *m_queues[index];
+        lock_guard lock(queue.queue_mutex);
+        if (! queue.tasks.empty())
+        {
+            task = move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+    auto nu_queues = static_cast<unsigned>(m_queues.size());
+    for (unsigned i = 1; ! task && i < nu_queues; ++i)
+    {
+        auto& queue = *m_queues[(index + i) % nu_queues];
+        lock_guard lock(queue.queue_mutex);
+        if (! queue.tasks.empty())
+        {
+            task = move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    if (! task)
+        return false;
+    m_nu_pending.fetch_sub(1);
+    task();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+TaskGroup::TaskGroup(ThreadPool& pool)
+    : m_pool(pool)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    wait_finished();
+}
+
+void TaskGroup::run(ThreadPool::Task task)
+{
+    {
+        lock_guard lock(m_mutex);
+        ++m_nu_running;
+    }
+    m_pool.submit([this, task = move(task)]
+    {
+        exception_ptr exception;
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            exception = current_exception();
+        }
+        lock_guard lock(m_mutex);
+        if (exception && ! m_exception)
+            m_exception = exception;
+        LIBBOARDGAME_ASSERT(m_nu_running > 0);
+        if (--m_nu_running == 0)
+            m_finished.notify_all();
+    });
+}
+
+void TaskGroup::wait()
+{
+    wait_finished();
+    exception_ptr exception;
+    {
+        lock_guard lock(m_mutex);
+        swap(exception, m_exception);
+    }
+    if (exception)
+        rethrow_exception(exception);
+}
+
+void TaskGroup::wait_finished()
+{
+    while (true)
+    {
+        {
+            lock_guard lock(m_mutex);
+            if (m_nu_running == 0)
+                return;
+        }
+        if (! m_pool.run_pending_task())
+            break;
+    }
+    // Remaining tasks are running in other threads
+    unique_lock lock(m_mutex);
+    while (m_nu_running > 0)
+        m_finished.wait(lock);
+}
+
+//-----------------------------------------------------------------------------
+
+} // namespace libboardgame_base
@@ -0,0 +1,148 @@
+//-----------------------------------------------------------------------------
+/** @file libboardgame_base/ThreadPool.h
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#ifndef LIBBOARDGAME_BASE_THREAD_POOL_H
+#define LIBBOARDGAME_BASE_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libboardgame_base {
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+/** Fixed number of worker threads that execute submitted tasks.
+    Each worker has its own task queue. Tasks submitted from a worker are
+    added to the queue of this worker and executed in LIFO order by it;
+    idle workers steal the oldest tasks from the queues of other workers.
+    Tasks submitted from other threads are distributed round-robin.
+    Usually, tasks are not submitted directly but with a TaskGroup, which
+    allows to wait for the tasks and propagates exceptions. */
+class ThreadPool
+{
+public:
+    using Task = function<void()>;
+
+    /** Constructor.
+        @param nu_threads The number of worker threads. If 0, the number of
+        hardware threads is used. */
+    explicit ThreadPool(unsigned nu_threads = 0);
+
+    /** Destructor.
+        Waits until all submitted tasks have finished. */
+    ~ThreadPool();
+
+    /** Get a pool with one worker per hardware thread.
+        Components that are used together in a process should submit
+        their tasks to this pool to share the available cores without
+        oversubscribing them. The pool is created at the first call. */
+    static ThreadPool& get_global();
+
+    unsigned get_nu_threads() const;
+
+    /** Submit a task.
+        The task must not throw exceptions. */
+    void submit(Task task);
+
+    /** Execute a pending task in the current thread.
+        Used by threads that wait for the results of other tasks.
+        @return false if no task was pending. */
+    bool run_pending_task();
+
+private:
+    struct Queue
+    {
+        mutex queue_mutex;
+
+        deque<Task> tasks;
+    };
+
+    /** Pool of the current thread if it is a worker, otherwise null. */
+    static thread_local const ThreadPool* s_current_pool;
+
+    /** Index of the current thread in its pool if it is a worker. */
+    static thread_local unsigned s_current_index;
+
+    vector<unique_ptr<Queue>> m_queues;
+
+    vector<thread> m_threads;
+
+    /** Number of tasks in all queues. */
+    atomic<size_t> m_nu_pending{0};
+
+    atomic<unsigned> m_next_queue{0};
+
+    mutex m_mutex;
+
+    condition_variable m_cond;
+
+    bool m_quit = false;
+
+    void thread_main(unsigned index);
+
+    bool try_run(unsigned index);
+};
+
+inline unsigned ThreadPool::get_nu_threads() const
+{
+    return static_cast<unsigned>(m_threads.size());
+}
+
+//-----------------------------------------------------------------------------
+
+/** Set of tasks that can be waited for.
+    While waiting, the waiting thread executes pending tasks of the pool,
+    so waiting from within a task of the same pool does not deadlock. */
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool& pool = ThreadPool::get_global());
+
+    /** Destructor.
+        Waits for the remaining tasks but ignores their exceptions. */
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(ThreadPool::Task task);
+
+    /** Wait until all tasks of the group have finished.
+        If a task threw an exception, the first exception is rethrown
+        after all tasks have finished. */
+    void wait();
+
+private:
+    ThreadPool& m_pool;
+
+    /** Number of submitted tasks that have not finished yet.
+        Protected by m_mutex. */
+    unsigned m_nu_running = 0;
+
+    mutex m_mutex;
+
+    condition_variable m_finished;
+
+    exception_ptr m_exception;
+
+    void wait_finished();
+};
+
+//-----------------------------------------------------------------------------
+
+} // namespace libboardgame_base
+
+#endif // LIBBOARDGAME_BASE_THREAD_POOL_H
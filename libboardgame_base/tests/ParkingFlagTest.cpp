@@ -0,0 +1,45 @@
+//-----------------------------------------------------------------------------
+/** @file libboardgame_base/tests/ParkingFlagTest.cpp
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include "libboardgame_base/ParkingFlag.h"
+
+#include <thread>
+#include "libboardgame_test/Test.h"
+
+using namespace std;
+using namespace libboardgame_base;
+
+//-----------------------------------------------------------------------------
+
+/** Pass a counter back and forth between two threads, once with blocking
+    and once with spinning waits. */
+LIBBOARDGAME_TEST_CASE(libboardgame_base_parking_flag_ping_pong)
+{
+    for (double spin_time : { 0., 1. })
+    {
+        ParkingFlag ping(spin_time);
+        ParkingFlag pong(spin_time);
+        unsigned count = 0;
+        thread t([&]
+        {
+            for (unsigned i = 0; i < 100; ++i)
+            {
+                ping.wait();
+                ++count;
+                pong.set();
+            }
+        });
+        for (unsigned i = 0; i < 100; ++i)
+        {
+            ping.set();
+            pong.wait();
+        }
+        t.join();
+        LIBBOARDGAME_CHECK_EQUAL(count, 100u);
+    }
+}
+
+//-----------------------------------------------------------------------------
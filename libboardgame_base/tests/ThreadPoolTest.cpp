@@ -0,0 +1,82 @@
+//-----------------------------------------------------------------------------
+/** @file libboardgame_base/tests/ThreadPoolTest.cpp
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include "libboardgame_base/ThreadPool.h"
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "libboardgame_test/Test.h"
+
+using namespace std;
+using namespace libboardgame_base;
+
+//-----------------------------------------------------------------------------
+
+LIBBOARDGAME_TEST_CASE(libboardgame_base_thread_pool_exception)
+{
+    ThreadPool pool(2);
+    TaskGroup group(pool);
+    atomic<unsigned> count(0);
+    for (unsigned i = 0; i < 10; ++i)
+        group.run([&count, i]
+        {
+            ++count;
+            if (i == 5)
+                throw runtime_error("test");
+        });
+    LIBBOARDGAME_CHECK_THROW(group.wait(), runtime_error);
+    LIBBOARDGAME_CHECK_EQUAL(count.load(), 10u);
+}
+
+/** Test that tasks waiting for nested tasks do not deadlock if there are
+    more waiting tasks than workers. */
+LIBBOARDGAME_TEST_CASE(libboardgame_base_thread_pool_nested)
+{
+    ThreadPool pool(2);
+    TaskGroup group(pool);
+    atomic<unsigned> count(0);
+    for (unsigned i = 0; i < 8; ++i)
+        group.run([&pool, &count]
+        {
+            TaskGroup nested(pool);
+            for (unsigned j = 0; j < 8; ++j)
+                nested.run([&count] { ++count; });
+            nested.wait();
+        });
+    group.wait();
+    LIBBOARDGAME_CHECK_EQUAL(count.load(), 64u);
+}
+
+/** Test submitting tasks from several threads that are not workers
+    concurrently with the workers taking them. */
+LIBBOARDGAME_TEST_CASE(libboardgame_base_thread_pool_concurrent_submit)
+{
+    ThreadPool pool(4);
+    atomic<unsigned> count(0);
+    vector<thread> submitters;
+    for (unsigned i = 0; i < 4; ++i)
+        submitters.emplace_back([&pool, &count]
+        {
+            for (unsigned j = 0; j < 100; ++j)
+            {
+                TaskGroup group(pool);
+                for (unsigned k = 0; k < 100; ++k)
+                    group.run([&count] { ++count; });
+                group.wait();
+            }
+        });
+    for (auto& t : submitters)
+        t.join();
+    LIBBOARDGAME_CHECK_EQUAL(count.load(), 40000u);
+    // Workers are idle now and a new task must still be run
+    TaskGroup group(pool);
+    group.run([&count] { ++count; });
+    group.wait();
+    LIBBOARDGAME_CHECK_EQUAL(count.load(), 40001u);
+}
+
+//-----------------------------------------------------------------------------
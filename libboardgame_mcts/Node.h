@@ -7,6 +7,8 @@
 #ifndef LIBBOARDGAME_MCTS_NODE_H
 #define LIBBOARDGAME_MCTS_NODE_H
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 #include "Atomic.h"
 #include "libboardgame_base/Assert.h"
@@ -19,11 +21,167 @@ using NodeIdx = uint_least32_t;
 
 //-----------------------------------------------------------------------------
 
+/** Storage for the visit count and the move prior of a Node.
+    @tparam COMPACT If false, both values are stored as Float. If true, they
+    are packed into a single 32-bit word: the visit count as a 24-bit
+    integer, which saturates at the same count as the mantissa of a float,
+    and the move prior as an 8-bit floating point number with a 3-bit
+    mantissa. The move prior must be in [0..1] in this case and is rounded
+    to a relative precision of about 6%. Priors below 2^-31 are stored as
+    2^-31. */
+template<typename F, bool MT, bool COMPACT> class NodeCountPrior;
+
+template<typename F, bool MT>
+class NodeCountPrior<F, MT, false>
+{
+public:
+    using Float = F;
+
+    void init(Float move_prior)
+    {
+        m_visit_count.store(0, memory_order_relaxed);
+        m_move_prior = move_prior;
+    }
+
+    void init_count() { m_visit_count.store(0, memory_order_relaxed); }
+
+    Float get_visit_count() const
+    {
+        return m_visit_count.load(memory_order_relaxed);
+    }
+
+    Float get_move_prior() const { return m_move_prior; }
+
+    void inc_visit_count()
+    {
+        // We don't care about the unlikely case that updates are lost because
+        // incrementing is not atomic
+        Float count = m_visit_count.load(memory_order_relaxed);
+        ++count;
+        m_visit_count.store(count, memory_order_relaxed);
+    }
+
+    void set_visit_count_st(Float count)
+    {
+        m_visit_count.store(count, memory_order_relaxed);
+    }
+
+    void copy_from(const NodeCountPrior& x)
+    {
+        m_move_prior = x.m_move_prior;
+        m_visit_count.store(x.m_visit_count.load(memory_order_relaxed),
+                            memory_order_relaxed);
+    }
+
+private:
+    Atomic<Float, MT> m_visit_count;
+
+    Float m_move_prior;
+};
+
+template<typename F, bool MT>
+class NodeCountPrior<F, MT, true>
+{
+public:
+    using Float = F;
+
+    void init(Float move_prior)
+    {
+        m_data.store(encode_prior(move_prior) << prior_shift,
+                     memory_order_relaxed);
+    }
+
+    void init_count()
+    {
+        auto data = m_data.load(memory_order_relaxed);
+        m_data.store(data & ~count_mask, memory_order_relaxed);
+    }
+
+    Float get_visit_count() const
+    {
+        return static_cast<Float>(m_data.load(memory_order_relaxed)
+                                  & count_mask);
+    }
+
+    Float get_move_prior() const
+    {
+        return decode_prior(m_data.load(memory_order_relaxed) >> prior_shift);
+    }
+
+    void inc_visit_count()
+    {
+        // We don't care about the unlikely case that updates are lost because
+        // incrementing is not atomic. The prior is never modified
+        // concurrently, so it cannot be lost.
+        auto data = m_data.load(memory_order_relaxed);
+        if ((data & count_mask) != count_mask)
+            m_data.store(data + 1, memory_order_relaxed);
+    }
+
+    void set_visit_count_st(Float count)
+    {
+        auto data = m_data.load(memory_order_relaxed);
+        auto n = static_cast<uint_least32_t>(
+                    min(count, static_cast<Float>(count_mask)));
+        m_data.store((data & ~count_mask) | n, memory_order_relaxed);
+    }
+
+    void copy_from(const NodeCountPrior& x)
+    {
+        m_data.store(x.m_data.load(memory_order_relaxed),
+                     memory_order_relaxed);
+    }
+
+private:
+    static constexpr unsigned prior_shift = 24;
+
+    static constexpr uint_least32_t count_mask = (1u << prior_shift) - 1;
+
+    /** Lowest exponent of a prior in the biased IEEE 754 representation. */
+    static constexpr uint_least32_t prior_min_exponent = 127 - 31;
+
+    Atomic<uint_least32_t, MT> m_data;
+
+
+    static uint_least32_t encode_prior(Float move_prior);
+
+    static Float decode_prior(uint_least32_t code);
+};
+
+template<typename F, bool MT>
+inline auto NodeCountPrior<F, MT, true>::decode_prior(uint_least32_t code)
+-> Float
+{
+    uint_least32_t bits = (code + (prior_min_exponent << 3)) << 20;
+    float prior;
+    memcpy(&prior, &bits, sizeof(prior));
+    return prior;
+}
+
+template<typename F, bool MT>
+uint_least32_t NodeCountPrior<F, MT, true>::encode_prior(Float move_prior)
+{
+    LIBBOARDGAME_ASSERT(move_prior >= 0);
+    LIBBOARDGAME_ASSERT(move_prior <= 1);
+    auto prior = static_cast<float>(move_prior);
+    uint_least32_t bits;
+    memcpy(&bits, &prior, sizeof(bits));
+    // Round to nearest 3-bit mantissa
+    bits = (bits + (1u << 19)) >> 20;
+    if (bits < (prior_min_exponent << 3))
+        return 0;
+    return min(bits - (prior_min_exponent << 3), uint_least32_t(31 << 3));
+}
+
+//-----------------------------------------------------------------------------
+
 /** %Node in a MCTS tree.
     For details about how the nodes are used in lock-free multi-threaded mode,
     see M. Enzenberger, M. Mueller: A Lock-free Multithreaded Monte-Carlo Tree
-    Search Algorithm. Advances in Computer Games 2009. */
-template<typename M, typename F, bool MT>
+    Search Algorithm. Advances in Computer Games 2009.
+    @tparam COMPACT Use a smaller node with a reduced precision of the move
+    prior (see NodeCountPrior). */
+template<typename M, typename F, bool MT, bool COMPACT = false>
 class Node
 {
 public:
@@ -60,7 +218,7 @@ public:
     /** Prior value for the move.
         This value is used in the exploration term, see description of class
         SearchBase. */
-    Float get_move_prior() const { return m_move_prior; }
+    Float get_move_prior() const { return m_count_prior.get_move_prior(); }
 
     /** Number of simulations that went through this node. */
     Float get_visit_count() const;
@@ -100,6 +258,10 @@ public:
         code. */
     void link_children_st(NodeIdx first_child, unsigned nu_children);
 
+    /** Unlink children.
+        Used for pruning subtrees during a multi-threaded search. */
+    void unlink_children();
+
     /** Unlink children.
         Only to be used in single-threaded parts of the code. */
     void unlink_children_st();
@@ -113,6 +275,14 @@ public:
 
     void inc_visit_count();
 
+    /** Overwrite value and value count.
+        Only to be used in single-threaded parts of the code. */
+    void set_value_st(Float value, Float value_count);
+
+    /** Overwrite the visit count.
+        Only to be used in single-threaded parts of the code. */
+    void set_visit_count_st(Float count);
+
     /** Get node index of first child.
         @pre get_nu_children() > 0. Note that in lock-free search, it can
         happen that get_nu_children() was greater 0 but becomes negative
@@ -129,9 +299,7 @@ private:
 
     Atomic<Float, MT> m_value_count;
 
-    Atomic<Float, MT> m_visit_count;
-
-    Float m_move_prior;
+    NodeCountPrior<F, MT, COMPACT> m_count_prior;
 
     /** See get_nu_children() */
     Atomic<short, MT> m_nu_children;
@@ -141,8 +309,8 @@ private:
     Atomic<NodeIdx, MT> m_first_child;
 };
 
-template<typename M, typename F, bool MT>
-void Node<M, F, MT>::add_value(Float v, Float weight)
+template<typename M, typename F, bool MT, bool COMPACT>
+void Node<M, F, MT, COMPACT>::add_value(Float v, Float weight)
 {
     // Intentionally uses no synchronization and does not care about
     // lost updates in multi-threaded mode
@@ -154,8 +322,8 @@ void Node<M, F, MT>::add_value(Float v, Float weight)
     m_value_count.store(count, memory_order_relaxed);
 }
 
-template<typename M, typename F, bool MT>
-void Node<M, F, MT>::add_value_remove_loss(Float v)
+template<typename M, typename F, bool MT, bool COMPACT>
+void Node<M, F, MT, COMPACT>::add_value_remove_loss(Float v)
 {
     // Intentionally uses no synchronization and does not care about
     // lost updates in multi-threaded mode
@@ -167,16 +335,15 @@ void Node<M, F, MT>::add_value_remove_loss(Float v)
     m_value.store(value, memory_order_relaxed);
 }
 
-template<typename M, typename F, bool MT>
-void Node<M, F, MT>::copy_data_from(const Node& node)
+template<typename M, typename F, bool MT, bool COMPACT>
+void Node<M, F, MT, COMPACT>::copy_data_from(const Node& node)
 {
     // Reminder to update this function when the class gets additional members
     struct Dummy
     {
         Atomic<Float, MT> m_value;
         Atomic<Float, MT> m_value_count;
-        Atomic<Float, MT> m_visit_count;
-        Float m_move_prior;
+        NodeCountPrior<F, MT, COMPACT> m_count_prior;
         Atomic<short, MT> m_nu_children;
         Move m_move;
         NodeIdx m_first_child;
@@ -184,59 +351,53 @@ void Node<M, F, MT>::copy_data_from(const Node& node)
     static_assert(sizeof(Node) == sizeof(Dummy));
 
     m_move = node.m_move;
-    m_move_prior = node.m_move_prior;
+    m_count_prior.copy_from(node.m_count_prior);
     // Load/store relaxed (it wouldn't even need to be atomic) because this
     // function is only used before the multi-threaded search.
     m_value_count.store(node.m_value_count.load(memory_order_relaxed),
                         memory_order_relaxed);
     m_value.store(node.m_value.load(memory_order_relaxed),
                   memory_order_relaxed);
-    m_visit_count.store(node.m_visit_count.load(memory_order_relaxed),
-                        memory_order_relaxed);
 }
 
-template<typename M, typename F, bool MT>
-inline auto Node<M, F, MT>::get_value_count() const -> Float
+template<typename M, typename F, bool MT, bool COMPACT>
+inline auto Node<M, F, MT, COMPACT>::get_value_count() const -> Float
 {
     return m_value_count.load(memory_order_relaxed);
 }
 
-template<typename M, typename F, bool MT>
-inline NodeIdx Node<M, F, MT>::get_first_child() const
+template<typename M, typename F, bool MT, bool COMPACT>
+inline NodeIdx Node<M, F, MT, COMPACT>::get_first_child() const
 {
     return m_first_child.load(memory_order_acquire);
 }
 
-template<typename M, typename F, bool MT>
-inline short Node<M, F, MT>::get_nu_children() const
+template<typename M, typename F, bool MT, bool COMPACT>
+inline short Node<M, F, MT, COMPACT>::get_nu_children() const
 {
     return m_nu_children.load(memory_order_acquire);
 }
 
-template<typename M, typename F, bool MT>
-inline auto Node<M, F, MT>::get_value() const -> Float
+template<typename M, typename F, bool MT, bool COMPACT>
+inline auto Node<M, F, MT, COMPACT>::get_value() const -> Float
 {
     return m_value.load(memory_order_relaxed);
 }
 
-template<typename M, typename F, bool MT>
-inline auto Node<M, F, MT>::get_visit_count() const -> Float
+template<typename M, typename F, bool MT, bool COMPACT>
+inline auto Node<M, F, MT, COMPACT>::get_visit_count() const -> Float
 {
-    return m_visit_count.load(memory_order_relaxed);
+    return m_count_prior.get_visit_count();
 }
 
-template<typename M, typename F, bool MT>
-inline void Node<M, F, MT>::inc_visit_count()
+template<typename M, typename F, bool MT, bool COMPACT>
+inline void Node<M, F, MT, COMPACT>::inc_visit_count()
 {
-    // We don't care about the unlikely case that updates are lost because
-    // incrementing is not atomic
-    Float count = m_visit_count.load(memory_order_relaxed);
-    ++count;
-    m_visit_count.store(count, memory_order_relaxed);
+    m_count_prior.inc_visit_count();
 }
 
-template<typename M, typename F, bool MT>
-void Node<M, F, MT>::init(const Move& mv, Float value, Float count,
+template<typename M, typename F, bool MT, bool COMPACT>
+void Node<M, F, MT, COMPACT>::init(const Move& mv, Float value, Float count,
                           Float move_prior)
 {
     // The node is not yet visible to other threads because init() is called
@@ -245,25 +406,24 @@ void Node<M, F, MT>::init(const Move& mv, Float value, Float count,
     // Therefore, the most efficient way here is to initialize all values with
     // memory_order_relaxed.
     m_move = mv;
-    m_move_prior = move_prior;
+    m_count_prior.init(move_prior);
     m_value_count.store(count, memory_order_relaxed);
     m_value.store(value, memory_order_relaxed);
-    m_visit_count.store(0, memory_order_relaxed);
     m_nu_children.store(value_unexpanded, memory_order_relaxed);
 }
 
-template<typename M, typename F, bool MT>
-void Node<M, F, MT>::init_root()
+template<typename M, typename F, bool MT, bool COMPACT>
+void Node<M, F, MT, COMPACT>::init_root()
 {
 #ifdef LIBBOARDGAME_DEBUG
     m_move = Move::null();
 #endif
-    m_visit_count.store(0, memory_order_relaxed);
+    m_count_prior.init_count();
     m_nu_children.store(value_unexpanded, memory_order_relaxed);
 }
 
-template<typename M, typename F, bool MT>
-inline void Node<M, F, MT>::link_children(NodeIdx first_child,
+template<typename M, typename F, bool MT, bool COMPACT>
+inline void Node<M, F, MT, COMPACT>::link_children(NodeIdx first_child,
                                           unsigned nu_children)
 {
     LIBBOARDGAME_ASSERT(nu_children < max_children);
@@ -281,8 +441,8 @@ inline void Node<M, F, MT>::link_children(NodeIdx first_child,
     m_nu_children.store(static_cast<short>(nu_children), memory_order_release);
 }
 
-template<typename M, typename F, bool MT>
-inline void Node<M, F, MT>::link_children_st(NodeIdx first_child,
+template<typename M, typename F, bool MT, bool COMPACT>
+inline void Node<M, F, MT, COMPACT>::link_children_st(NodeIdx first_child,
                                              unsigned nu_children)
 {
     LIBBOARDGAME_ASSERT(nu_children < max_children);
@@ -294,14 +454,35 @@ inline void Node<M, F, MT>::link_children_st(NodeIdx first_child,
     m_nu_children.store(static_cast<short>(nu_children), memory_order_relaxed);
 }
 
-template<typename M, typename F, bool MT>
-void Node<M, F, MT>::set_expanding()
+template<typename M, typename F, bool MT, bool COMPACT>
+inline void Node<M, F, MT, COMPACT>::set_value_st(Float value, Float value_count)
+{
+    // Store relaxed (wouldn't even need to be atomic)
+    m_value.store(value, memory_order_relaxed);
+    m_value_count.store(value_count, memory_order_relaxed);
+}
+
+template<typename M, typename F, bool MT, bool COMPACT>
+inline void Node<M, F, MT, COMPACT>::set_visit_count_st(Float count)
+{
+    // Store relaxed (wouldn't even need to be atomic)
+    m_count_prior.set_visit_count_st(count);
+}
+
+template<typename M, typename F, bool MT, bool COMPACT>
+void Node<M, F, MT, COMPACT>::set_expanding()
 {
     m_nu_children.store(value_expanding, memory_order_relaxed);
 }
 
-template<typename M, typename F, bool MT>
-inline void Node<M, F, MT>::unlink_children_st()
+template<typename M, typename F, bool MT, bool COMPACT>
+inline void Node<M, F, MT, COMPACT>::unlink_children()
+{
+    m_nu_children.store(value_unexpanded, memory_order_release);
+}
+
+template<typename M, typename F, bool MT, bool COMPACT>
+inline void Node<M, F, MT, COMPACT>::unlink_children_st()
 {
     // Store relaxed (wouldn't even need to be atomic)
     m_nu_children.store(value_unexpanded, memory_order_relaxed);
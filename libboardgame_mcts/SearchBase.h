@@ -8,13 +8,13 @@
 #define LIBBOARDGAME_MCTS_SEARCH_BASE_H
 
 #include <array>
-#include <condition_variable>
 #include <functional>
 #include <mutex>
 #include <thread>
 #include "Atomic.h"
 #include "LastGoodReply.h"
 #include "PlayerMove.h"
+#include "TranspositionTable.h"
 #include "Tree.h"
 #include "TreeUtil.h"
 #include "libboardgame_base/ArrayList.h"
@@ -22,9 +22,11 @@
 #include "libboardgame_base/Compiler.h"
 #include "libboardgame_base/IntervalChecker.h"
 #include "libboardgame_base/Log.h"
+#include "libboardgame_base/ParkingFlag.h"
 #include "libboardgame_base/RandomGenerator.h"
 #include "libboardgame_base/Statistics.h"
 #include "libboardgame_base/StringUtil.h"
+#include "libboardgame_base/ThreadPool.h"
 #include "libboardgame_base/TimeIntervalChecker.h"
 #include "libboardgame_base/Timer.h"
 
@@ -36,10 +38,13 @@ using libboardgame_base::to_string;
 using libboardgame_base::ArrayList;
 using libboardgame_base::Barrier;
 using libboardgame_base::IntervalChecker;
+using libboardgame_base::ParkingFlag;
 using libboardgame_base::RandomGenerator;
 using libboardgame_base::StatisticsBase;
 using libboardgame_base::StatisticsDirty;
 using libboardgame_base::StatisticsExt;
+using libboardgame_base::TaskGroup;
+using libboardgame_base::ThreadPool;
 using libboardgame_base::Timer;
 using libboardgame_base::TimeIntervalChecker;
 using libboardgame_base::TimeSource;
@@ -78,6 +83,14 @@ struct SearchParamConstDefault
         multi-threaded search is not needed. */
     static constexpr bool multithread = true;
 
+    /** Use a smaller node layout.
+        Packs the visit count and the move prior of a node into a single
+        word, which reduces the node size from 24 to 20 bytes with the
+        default types, at the cost of a lower precision of the move prior.
+        Requires that max_move_prior is not greater than 1.
+        @see NodeCountPrior */
+    static constexpr bool compact_node = false;
+
     /** Use RAVE. */
     static constexpr bool rave = false;
 
@@ -181,7 +194,12 @@ public:
 
     using Float = typename SearchParamConst::Float;
 
-    using Node = libboardgame_mcts::Node<M, Float, multithread>;
+    static constexpr bool compact_node = SearchParamConst::compact_node;
+
+    static_assert(! compact_node || SearchParamConst::max_move_prior <= 1);
+
+    using Node =
+        libboardgame_mcts::Node<M, Float, multithread, compact_node>;
 
     using Tree = libboardgame_mcts::Tree<Node>;
 
@@ -242,6 +260,17 @@ public:
 
     virtual string get_info_ext() const;
 
+    /** Write the information that check_followup() needs about the position
+        of the last search to a tree file.
+        The default implementation writes nothing.
+        @see save_tree() */
+    virtual void write_followup_info(ostream& out) const;
+
+    /** Read the information written by write_followup_info().
+        The default implementation reads nothing.
+        @throws runtime_error If the information is invalid. */
+    virtual void read_followup_info(istream& in);
+
     /** @} */ // @name
 
 
@@ -288,6 +317,93 @@ public:
 
     Float get_rave_weight() const;
 
+    /** Use root parallelization instead of a shared tree.
+        In this mode, each thread searches its own private tree and the
+        statistics of the root children are merged periodically and at the
+        end of the search. This avoids contention on the upper nodes of
+        the tree and keeps each thread's nodes in its own memory, but the
+        memory is split between the trees and the trees are less deep.
+        Only the subtree of the first thread is kept for reusing subtrees in
+        the next search. Changing this parameter discards the current tree.
+        The default value is false. */
+    void set_root_parallel(bool enable) { m_root_parallel = enable; }
+
+    bool get_root_parallel() const { return m_root_parallel; }
+
+    /** Time interval in seconds for merging the root statistics in
+        root-parallel mode. */
+    void set_root_merge_interval(double t) { m_root_merge_interval = t; }
+
+    double get_root_merge_interval() const { return m_root_merge_interval; }
+
+    /** Place the memory of each thread on its NUMA node.
+        If enabled, each search thread (including the thread that calls
+        search()) is pinned to a CPU and first-touches its own part of the
+        node storage of the trees, so that the nodes created by a thread are
+        local to it. Changing this parameter discards the current tree.
+        The default value is false. */
+    void set_numa(bool enable) { m_numa = enable; }
+
+    bool get_numa() const { return m_numa; }
+
+    /** Number of simulations that a thread keeps in flight.
+        If greater than 1, each thread first plays the in-tree phase of a
+        batch of simulations, then the playouts, and then updates the tree
+        with the results of all simulations of the batch. Each simulation of
+        a batch uses its own state. Interleaving the simulations hides some of
+        the memory latency of the tree accesses and allows an evaluation of
+        the positions of all leaves of a batch at once. Virtual losses are
+        used to make the simulations of a batch select different paths if
+        enabled in SearchParamConst. The default value is 1. */
+    void set_batch_size(unsigned n);
+
+    unsigned get_batch_size() const { return m_batch_size; }
+
+    /** Run the search threads as tasks of a thread pool.
+        If null, each search thread other than the thread that calls search()
+        is a dedicated thread owned by the search. With a pool, several
+        searches or other components of a process can share a fixed number
+        of cores. The threads are not pinned to CPUs in this mode, so
+        set_numa() has no effect. The default value is null. */
+    void set_thread_pool(ThreadPool* pool) { m_thread_pool = pool; }
+
+    ThreadPool* get_thread_pool() const { return m_thread_pool; }
+
+    /** Adapt the duration of searches with a time limit to their stability.
+        If greater than zero, a search with time limit t stops after t/4
+        already if the best move dominates (it has at least 4 times the wins
+        of the second best move), and continues after t if the search is
+        unstable, up to max_factor * t. The search is unstable if the best
+        move changed during the last t/4 or the value of the root changed
+        by more than 0.02 during the last t/2. Searches with a maximum count
+        are not affected. The default value is 0 (disabled).
+        @pre max_factor == 0 || max_factor >= 1 */
+    void set_adaptive_time(double max_factor);
+
+    double get_adaptive_time() const { return m_adaptive_time; }
+
+    /** Try to use huge pages for the memory of the trees.
+        This reduces TLB misses when descending in the tree. If huge pages
+        are not available, normal pages are used. Changing this parameter
+        discards the current tree.
+        The default value is false. */
+    void set_huge_pages(bool enable) { m_huge_pages = enable; }
+
+    bool get_huge_pages() const { return m_huge_pages; }
+
+    /** Share the children of nodes that correspond to the same position.
+        Positions that are reached by different move sequences are detected
+        with the hash returned by State::get_hash() in the in-tree phase and
+        a transposition table. Nodes of the same position share their
+        children, so the statistics of the moves in the position are shared
+        too. The table needs about 2 bytes per node of the tree in
+        addition to the tree memory. Not used in root-parallel mode.
+        Changing this parameter discards the current tree.
+        The default value is false. */
+    void set_transpositions(bool enable) { m_transpositions = enable; }
+
+    bool get_transpositions() const { return m_transpositions; }
+
     /** @} */ // @name
 
 
@@ -306,6 +422,22 @@ public:
 
     const Tree& get_tree() const;
 
+    /** Save the tree of the last search to a file.
+        The file also contains the information needed for reusing the tree
+        in a search of the same or a follow-up position.
+        @see Tree::save()
+        @throws runtime_error */
+    void save_tree(const string& file) const;
+
+    /** Load a tree saved with save_tree().
+        The next search reuses the tree as if it was the tree of the last
+        search, if enabled with set_reuse_subtree() or set_reuse_tree().
+        If the tree was saved with a different number of threads or memory,
+        or if huge pages or NUMA mode are enabled, it is copied into the tree
+        of this search as far as it fits.
+        @throws runtime_error */
+    void load_tree(const string& file);
+
 #ifdef LIBBOARDGAME_DEBUG
     string dump() const;
 #endif
@@ -313,6 +445,13 @@ public:
     /** Number of simulations in the current search in all threads. */
     size_t get_nu_simulations() const;
 
+    /** Duration of the last search. */
+    double get_last_time() const { return m_last_time; }
+
+    /** Average number of in-tree moves per simulation in the last search
+        over all threads. */
+    double get_avg_in_tree_len() const;
+
     /** Select the move to play.
         Uses select_final(). */
     bool select_move(Move& mv) const;
@@ -372,6 +511,14 @@ protected:
 
     virtual void on_start_search(bool is_followup);
 
+    /** Call a function for the indices 0 to n - 1 in the threads of the
+        search.
+        Can be used by subclasses to parallelize work in on_start_search().
+        The indices are distributed dynamically to at most n threads
+        including the current thread. The function returns after all calls
+        finished. Must not be called while the search threads are running. */
+    void parallel_for(unsigned n, const function<void(unsigned)>& func);
+
 private:
 #ifdef LIBBOARDGAME_DEBUG
     class AssertionHandler
@@ -387,18 +534,45 @@ private:
     };
 #endif
 
+    /** Statistics of a node used for merging the root children in
+        root-parallel mode. */
+    struct RootStat
+    {
+        double wins;
+
+        double value_count;
+
+        double visit_count;
+    };
+
+    /** A simulation of a thread with its own state. */
+    struct SimulationSlot
+    {
+        unique_ptr<State> state;
+
+        Simulation simulation;
+    };
+
     /** Thread-specific search state. */
     struct ThreadState
     {
-        unique_ptr<State> state;
+        /** The simulations in flight.
+            Contains get_batch_size() elements. The state of the first
+            element is also used outside of simulations (see get_state()). */
+        vector<SimulationSlot> slots;
 
         unsigned thread_id;
 
-        /** Was the search in this thread terminated because the search tree
-            was full? */
-        bool is_out_of_mem;
+        /** The tree used by this thread.
+            Points to m_tree unless in root-parallel mode. */
+        Tree* tree;
 
-        Simulation simulation;
+        /** The thread storage of the tree used by this thread. */
+        unsigned storage_id;
+
+        /** Could the last simulation not expand a node because the search
+            tree was full? */
+        bool is_out_of_mem;
 
         StatisticsExt<> stat_len;
 
@@ -411,13 +585,38 @@ private:
         /** Local variable for update_rave().
             Reused for efficiency. */
         array<unsigned, Move::range> first_play;
+
+        /** @name Members only used in root-parallel mode */
+        /** @{ */
+
+        /** Private tree (unused in thread 0, which uses m_tree). */
+        unique_ptr<Tree> private_tree;
+
+        /** Root value of the simulations since the last merge. */
+        array<StatisticsDirty<Float>, max_players> root_val;
+
+        /** Statistics of the root (index 0) and its children (index 1..n)
+            at the last merge. */
+        vector<RootStat> merged_stat;
+
+        double last_merge_time;
+
+        /** Minimum count for pruning the private tree. */
+        Float prune_min_count;
+
+        /** @} */ // @name
     };
 
     /** Thread in the parallel search.
-        The thread waits for a call to start_search(), then runs
-        SearchBase::search_loop()) with the thread-specific search state.
-        After start_search(), wait_search_finished() needs to called before
-        calling start_search() again or destructing this object. */
+        The thread waits for a call to start_func(), then runs the function
+        (usually SearchBase::search_loop()) with the thread-specific search
+        state. After start_func(), wait_search_finished() needs to called
+        before calling start_func() again or destructing this object.
+        The handoff uses flags that the waiting side spins on for a short
+        time before blocking, so that starting and finishing the threads
+        has a low latency if searches follow each other quickly.
+        Not used as a thread if the search uses a thread pool, only as a
+        container for the thread-specific search state. */
     class Thread
     {
     public:
@@ -426,38 +625,25 @@ private:
 
         ThreadState thread_state;
 
-        explicit Thread(SearchFunc& search_func);
-
         ~Thread();
 
         void run();
 
-        void start_search();
+        void start_func(const SearchFunc& func);
 
         void wait_search_finished();
 
     private:
-        SearchFunc m_search_func;
+        const SearchFunc* m_func = nullptr;
 
         bool m_quit = false;
 
-        bool m_start_search_flag = false;
+        ParkingFlag m_start_flag;
 
-        bool m_search_finished_flag = false;
+        ParkingFlag m_finished_flag;
 
         Barrier m_thread_ready{2};
 
-        mutex m_start_search_mutex;
-
-        mutex m_search_finished_mutex;
-
-        condition_variable m_start_search_cond;
-
-        condition_variable m_search_finished_cond;
-
-        unique_lock<mutex> m_search_finished_lock{m_search_finished_mutex,
-                                                  defer_lock};
-
         thread m_thread;
 
         void thread_main();
@@ -470,6 +656,17 @@ private:
 
     Tree m_tree;
 
+    /** Transposition table for m_tree.
+        Null if transpositions are not used. */
+    unique_ptr<TranspositionTable<multithread>> m_tt;
+
+    /** Root statistics merged from all threads in root-parallel mode.
+        Index 0 is the root, index 1..n are its children. Protected by
+        m_root_stat_mutex. */
+    vector<RootStat> m_root_stat;
+
+    mutable mutex m_root_stat_mutex;
+
     /** See get_root_val(). */
     array<StatisticsDirty<Float>, max_players> m_root_val;
 
@@ -483,8 +680,43 @@ private:
 
     unsigned m_nu_threads;
 
+    size_t m_memory;
+
     bool m_deterministic;
 
+    bool m_root_parallel = false;
+
+    /** Mode that the trees are currently allocated for. */
+    bool m_trees_root_parallel = false;
+
+    bool m_numa = false;
+
+    /** NUMA mode that the trees are currently allocated for. */
+    bool m_trees_numa = false;
+
+    bool m_huge_pages = false;
+
+    /** Huge pages mode that the trees are currently allocated for. */
+    bool m_trees_huge_pages = false;
+
+    bool m_transpositions = false;
+
+    /** Transposition mode that the trees are currently allocated for. */
+    bool m_trees_transpositions = false;
+
+    double m_root_merge_interval = 0.25;
+
+    unsigned m_batch_size = 1;
+
+    ThreadPool* m_thread_pool = nullptr;
+
+    /** Thread pool that the threads are currently created for. */
+    ThreadPool* m_threads_pool = nullptr;
+
+    /** Are virtual losses used in the current search?
+        See SearchParamConst::virtual_loss. */
+    bool m_virtual_loss;
+
     bool m_reuse_subtree = true;
 
     bool m_reuse_tree = false;
@@ -501,6 +733,12 @@ private:
 
     atomic<bool> m_abort = false;
 
+    /** Was the tree loaded with load_tree() after the last search?
+        The tree can be reused in this case, but caches of the last search
+        that are invalidated only if the next search is not a follow-up
+        (see on_start_search()) were not restored. */
+    bool m_is_tree_loaded = false;
+
     Float m_rave_parent_max = 50000;
 
     Float m_rave_child_max = 2000;
@@ -517,9 +755,41 @@ private:
         previous search. */
     Float m_max_count;
 
+    /** Visit count of the root at the start of the current search. */
+    Float m_reused_count;
+
     /** Maximum time of current search. */
     double m_max_time;
 
+    double m_adaptive_time = 0;
+
+    /** @name Members used for adapting the time limit in thread 0
+        See set_adaptive_time(). */
+    /** @{ */
+
+    /** Current time limit of the search.
+        Equal to m_max_time unless adaptive time is used. */
+    atomic<double> m_time_limit;
+
+    /** Index of the best root child at the last check. */
+    size_t m_stable_best;
+
+    /** Time of the last change of the best root child. */
+    double m_best_change_time;
+
+    /** Root value at m_val_ref_time. */
+    Float m_val_ref;
+
+    /** Start of the current interval for measuring the change of the root
+        value (negative if not yet initialized). */
+    double m_val_ref_time;
+
+    /** Change of the root value in the last completed interval of
+        m_max_time / 2. */
+    Float m_val_change;
+
+    /** @} */ // @name
+
     TimeSource* m_time_source;
 
     Float m_exploration_constant = 0;
@@ -528,7 +798,11 @@ private:
 
     vector<unique_ptr<Thread>> m_threads;
 
-    Tree m_tmp_tree;
+    /** Ensures that only one thread prunes m_tree at a time. */
+    mutex m_prune_mutex;
+
+    /** Minimum count for pruning m_tree. Protected by m_prune_mutex. */
+    Float m_prune_min_count;
 
 #ifdef LIBBOARDGAME_DEBUG
     AssertionHandler m_assertion_handler;
@@ -539,55 +813,66 @@ private:
 
     ArrayList<Move, max_moves> m_followup_sequence;
 
+    void allocate_trees();
+
     bool check_abort(const ThreadState& thread_state) const;
 
     LIBBOARDGAME_NOINLINE
-    bool check_abort_expensive(ThreadState& thread_state) const;
+    bool check_abort_expensive(ThreadState& thread_state);
 
     bool check_cannot_change(ThreadState& thread_state, Float remaining) const;
 
+    void get_max_wins(Float& max_wins, Float& second_max,
+                      size_t& best) const;
+
     bool estimate_reused_root_val(Tree& tree, const Node& root, Float& value,
                                   Float& count);
 
-    bool expand_node(ThreadState& thread_state, const Node& node,
-                     const Node*& best_child);
+    bool expand_node(ThreadState& thread_state, State& state,
+                     const Node& node, const Node*& best_child);
+
+    Float get_current_root_count(const ThreadState& thread_state) const;
+
+    void init_root_parallel(unsigned nu_threads);
+
+    void init_thread_memory(ThreadState& thread_state);
+
+    void merge_root_stat(ThreadState& thread_state);
+
+    static string page_size_to_string(size_t page_size);
+
+    void playout(SimulationSlot& slot);
 
-    void playout(ThreadState& thread_state);
+    void play_in_tree(ThreadState& thread_state, SimulationSlot& slot);
 
-    void play_in_tree(ThreadState& thread_state);
+    void prune(ThreadState& thread_state);
 
-    bool prune(TimeSource& time_source, double time, Float prune_min_count,
-               Float& new_prune_min_count);
+    void run_threads(unsigned nu_threads,
+                     const typename Thread::SearchFunc& func);
 
     void search_loop(ThreadState& thread_state);
 
     const Node* select_child(const Node& node,
                              const typename Tree::Children& children);
 
-    void update_lgr(ThreadState& thread_state);
+    void update_lgr(const Simulation& simulation);
 
-    void update_rave(ThreadState& thread_state);
+    void update_time_limit(ThreadState& thread_state, double time);
 
-    void update_values(ThreadState& thread_state);
+    void update_rave(ThreadState& thread_state, const SimulationSlot& slot);
+
+    void update_values(ThreadState& thread_state,
+                       const Simulation& simulation);
 };
 
 
-template<class S, class M, class R>
-SearchBase<S, M, R>::Thread::Thread(SearchFunc& search_func)
-    : m_search_func(search_func)
-{ }
-
 template<class S, class M, class R>
 SearchBase<S, M, R>::Thread::~Thread()
 {
     if (! m_thread.joinable())
         return;
     m_quit = true;
-    {
-        lock_guard lock(m_start_search_mutex);
-        m_start_search_flag = true;
-    }
-    m_start_search_cond.notify_one();
+    m_start_flag.set();
     m_thread.join();
 }
 
@@ -599,35 +884,24 @@ void SearchBase<S, M, R>::Thread::run()
 }
 
 template<class S, class M, class R>
-void SearchBase<S, M, R>::Thread::start_search()
+void SearchBase<S, M, R>::Thread::start_func(const SearchFunc& func)
 {
     LIBBOARDGAME_ASSERT(m_thread.joinable());
-    m_search_finished_lock.lock();
-    {
-        lock_guard lock(m_start_search_mutex);
-        m_start_search_flag = true;
-    }
-    m_start_search_cond.notify_one();
+    m_func = &func;
+    m_start_flag.set();
 }
 
 template<class S, class M, class R>
 void SearchBase<S, M, R>::Thread::thread_main()
 {
-    unique_lock<mutex> lock(m_start_search_mutex);
     m_thread_ready.wait();
     while (true)
     {
-        while (! m_start_search_flag)
-            m_start_search_cond.wait(lock);
-        m_start_search_flag = false;
+        m_start_flag.wait();
         if (m_quit)
             break;
-        m_search_func(thread_state);
-        {
-            lock_guard lock(m_search_finished_mutex);
-            m_search_finished_flag = true;
-        }
-        m_search_finished_cond.notify_one();
+        (*m_func)(thread_state);
+        m_finished_flag.set();
     }
 }
 
@@ -635,10 +909,7 @@ template<class S, class M, class R>
 void SearchBase<S, M, R>::Thread::wait_search_finished()
 {
     LIBBOARDGAME_ASSERT(m_thread.joinable());
-    while (! m_search_finished_flag)
-        m_search_finished_cond.wait(m_search_finished_lock);
-    m_search_finished_flag = false;
-    m_search_finished_lock.unlock();
+    m_finished_flag.wait();
 }
 
 
@@ -660,9 +931,9 @@ void SearchBase<S, M, R>::AssertionHandler::run()
 
 template<class S, class M, class R>
 SearchBase<S, M, R>::SearchBase(unsigned nu_threads, size_t memory)
-    : m_tree(memory / 2, nu_threads),
+    : m_tree(memory, nu_threads),
       m_nu_threads(nu_threads),
-      m_tmp_tree(memory / 2, m_nu_threads)
+      m_memory(memory)
 #ifdef LIBBOARDGAME_DEBUG
       , m_assertion_handler(*this)
 #endif
@@ -671,11 +942,71 @@ SearchBase<S, M, R>::SearchBase(unsigned nu_threads, size_t memory)
 template<class S, class M, class R>
 SearchBase<S, M, R>::~SearchBase() = default; // Non-inline to avoid GCC -Winline warning
 
+template<class S, class M, class R>
+void SearchBase<S, M, R>::allocate_trees()
+{
+    // Free the old trees before allocating the new ones to avoid a peak in
+    // memory usage
+    m_tree = Tree(0, 1);
+    m_tt.reset();
+    for (auto& i : m_threads)
+        i->thread_state.private_tree.reset();
+    if (m_root_parallel)
+    {
+        auto memory = m_memory / m_nu_threads;
+        m_tree = Tree(memory, 1, m_huge_pages);
+        for (auto& i : m_threads)
+        {
+            auto& thread_state = i->thread_state;
+            if (thread_state.thread_id == 0)
+                continue;
+            thread_state.private_tree =
+                    make_unique<Tree>(memory, 1, m_huge_pages);
+        }
+    }
+    else
+    {
+        m_tree = Tree(m_memory, m_nu_threads, m_huge_pages);
+        if (m_transpositions)
+        {
+            m_tree.set_allow_shared_children(true);
+            m_tt = make_unique<TranspositionTable<multithread>>(
+                        m_tree.get_max_nodes() / 8);
+        }
+    }
+    for (auto& i : m_threads)
+    {
+        auto& thread_state = i->thread_state;
+        if (thread_state.private_tree)
+        {
+            thread_state.tree = thread_state.private_tree.get();
+            thread_state.storage_id = 0;
+        }
+        else
+        {
+            thread_state.tree = &m_tree;
+            thread_state.storage_id = (m_root_parallel ?
+                                       0 : thread_state.thread_id);
+        }
+    }
+    m_trees_root_parallel = m_root_parallel;
+    if (m_numa && ! m_thread_pool && ! m_threads.empty())
+    {
+        // The trees were just allocated, so their memory is not used yet
+        typename Thread::SearchFunc init_func =
+                bind(&SearchBase::init_thread_memory, this, placeholders::_1);
+        run_threads(static_cast<unsigned>(m_threads.size()), init_func);
+    }
+    m_trees_numa = m_numa;
+    m_trees_huge_pages = m_huge_pages;
+    m_trees_transpositions = m_transpositions;
+}
+
 template<class S, class M, class R>
 bool SearchBase<S, M, R>::check_abort(
         [[maybe_unused]] const ThreadState& thread_state) const
 {
-    if (m_max_count > 0 && m_tree.get_root().get_visit_count() >= m_max_count)
+    if (m_max_count > 0 && get_current_root_count(thread_state) >= m_max_count)
     {
         LIBBOARDGAME_LOG_THREAD(thread_state, "Maximum count reached");
         return true;
@@ -684,8 +1015,7 @@ bool SearchBase<S, M, R>::check_abort(
 }
 
 template<class S, class M, class R>
-bool SearchBase<S, M, R>::check_abort_expensive(
-        ThreadState& thread_state) const
+bool SearchBase<S, M, R>::check_abort_expensive(ThreadState& thread_state)
 {
     if (m_abort)
     {
@@ -693,14 +1023,21 @@ bool SearchBase<S, M, R>::check_abort_expensive(
         return true;
     }
     static_assert(numeric_limits<Float>::radix == 2);
-    auto count = m_tree.get_root().get_visit_count();
-    if (count >= (size_t(1) << numeric_limits<Float>::digits) - 1)
+    if (thread_state.tree->get_root().get_visit_count()
+            >= (size_t(1) << numeric_limits<Float>::digits) - 1)
     {
         LIBBOARDGAME_LOG_THREAD(thread_state,
                                 "Max count supported by float exceeded");
         return true;
     }
+    auto count = get_current_root_count(thread_state);
     auto time = m_timer();
+    if (m_trees_root_parallel
+            && time - thread_state.last_merge_time >= m_root_merge_interval)
+    {
+        merge_root_stat(thread_state);
+        thread_state.last_merge_time = time;
+    }
     if (! m_deterministic && time < 0.1)
         // Simulations per second might be inaccurate for very small times
         return false;
@@ -717,12 +1054,15 @@ bool SearchBase<S, M, R>::check_abort_expensive(
     if (m_max_count == 0)
     {
         // Search uses time limit
-        if (time > m_max_time)
+        if (m_adaptive_time > 0 && thread_state.thread_id == 0)
+            update_time_limit(thread_state, time);
+        auto time_limit = m_time_limit.load(memory_order_relaxed);
+        if (time > time_limit)
         {
             LIBBOARDGAME_LOG_THREAD(thread_state, "Maximum time reached");
             return true;
         }
-        remaining_time = m_max_time - time;
+        remaining_time = time_limit - time;
         remaining_simulations = Float(remaining_time * simulations_per_sec);
     }
     else
@@ -741,17 +1081,10 @@ bool SearchBase<S, M, R>::check_cannot_change(
         [[maybe_unused]] ThreadState& thread_state, Float remaining) const
 {
     // select_final() selects move with highest number of wins.
-    Float max_wins = 0;
-    Float second_max = 0;
-    for (auto& i : m_tree.get_root_children())
-    {
-        Float wins = i.get_value() * i.get_value_count();
-        if (wins > max_wins)
-        {
-            second_max = max_wins;
-            max_wins = wins;
-        }
-    }
+    Float max_wins;
+    Float second_max;
+    size_t best;
+    get_max_wins(max_wins, second_max, best);
     Float diff = max_wins - second_max;
     // Weight remaining number of simulations with current global win rate,
     // but not less than 10%
@@ -771,6 +1104,41 @@ bool SearchBase<S, M, R>::check_cannot_change(
     return true;
 }
 
+/** Get the highest and second highest number of wins of the root children.
+    @param[out] max_wins
+    @param[out] second_max
+    @param[out] best The index of the child with the highest number of
+    wins. */
+template<class S, class M, class R>
+void SearchBase<S, M, R>::get_max_wins(Float& max_wins, Float& second_max,
+                                       size_t& best) const
+{
+    max_wins = 0;
+    second_max = 0;
+    best = 0;
+    size_t i = 0;
+    auto add_wins = [&](Float wins) {
+        if (wins > max_wins)
+        {
+            second_max = max_wins;
+            max_wins = wins;
+            best = i;
+        }
+        else if (wins > second_max)
+            second_max = wins;
+        ++i;
+    };
+    if (m_trees_root_parallel)
+    {
+        lock_guard lock(m_root_stat_mutex);
+        for (size_t j = 1; j < m_root_stat.size(); ++j)
+            add_wins(Float(m_root_stat[j].wins));
+    }
+    else
+        for (auto& child : m_tree.get_root_children())
+            add_wins(child.get_value() * child.get_value_count());
+}
+
 template<class S, class M, class R>
 bool SearchBase<S, M, R>::check_followup(
         [[maybe_unused]] ArrayList<Move, max_moves>& sequence)
@@ -787,21 +1155,25 @@ void SearchBase<S, M, R>::create_threads()
     LIBBOARDGAME_LOG("Creating ", m_nu_threads, " threads");
     m_threads.clear();
     m_threads.reserve(m_nu_threads);
-    auto search_func =
-        static_cast<typename Thread::SearchFunc>(
-                          bind(&SearchBase::search_loop, this, placeholders::_1));
     for (unsigned i = 0; i < m_nu_threads; ++i)
     {
-        auto t = make_unique<Thread>(search_func);
+        auto t = make_unique<Thread>();
         auto& thread_state = t->thread_state;
         thread_state.thread_id = i;
-        thread_state.state = create_state();
+        thread_state.tree = &m_tree;
+        thread_state.storage_id = i;
+        thread_state.slots.resize(m_batch_size);
+        for (auto& slot : thread_state.slots)
+            slot.state = create_state();
         for (auto& was_played : thread_state.was_played)
             was_played = max_players;
-        if (i > 0)
+        if (i > 0 && ! m_thread_pool)
             t->run();
         m_threads.push_back(move(t));
     }
+    m_threads_pool = m_thread_pool;
+    if (m_trees_root_parallel || m_numa)
+        allocate_trees();
 }
 
 #ifdef LIBBOARDGAME_DEBUG
@@ -820,24 +1192,79 @@ string SearchBase<S, M, R>::dump() const
 
 template<class S, class M, class R>
 bool SearchBase<S, M, R>::expand_node(ThreadState& thread_state,
-                                      const Node& node,
+                                      State& state, const Node& node,
                                       const Node*& best_child)
 {
-    auto& state = *thread_state.state;
-    auto thread_id = thread_state.thread_id;
-    typename Tree::NodeExpander expander(thread_id, m_tree,
+    auto& tree = *thread_state.tree;
+    uint_least64_t hash = 0;
+    // Generation of the transposition table before linking new children
+    uint_least32_t tt_generation = 0;
+    if (m_tt && &tree == &m_tree)
+    {
+        hash = state.get_hash();
+        NodeIdx first_child;
+        unsigned nu_children;
+        uint_least32_t generation;
+        if (m_tt->lookup(hash, first_child, nu_children, generation))
+        {
+            tree.link_shared_children(node, first_child, nu_children);
+            if (m_tt->get_generation() == generation)
+            {
+                best_child = select_child(node, tree.get_children(node));
+                return true;
+            }
+            // A concurrent prune() invalidated the table and might not have
+            // seen the link
+            tree.set_unexpanded(node);
+            tree.set_expanding(node);
+        }
+        tt_generation = m_tt->get_generation();
+    }
+    typename Tree::NodeExpander expander(thread_state.storage_id, tree,
                                          SearchParamConst::child_min_count,
                                          SearchParamConst::max_move_prior);
     auto root_val = m_root_val[state.get_player()].get_mean();
     if (state.gen_children(expander, root_val))
     {
-        expander.link_children(m_tree, node);
+        expander.link_children(tree, node);
         best_child = expander.get_best_child();
+        if (m_tt && &tree == &m_tree && node.get_nu_children() > 0)
+            m_tt->store(hash, node.get_first_child(),
+                        static_cast<unsigned>(node.get_nu_children()),
+                        tt_generation);
         return true;
     }
     return false;
 }
 
+template<class S, class M, class R>
+double SearchBase<S, M, R>::get_avg_in_tree_len() const
+{
+    double sum = 0;
+    double count = 0;
+    for (auto& i : m_threads)
+    {
+        auto& stat = i->thread_state.stat_in_tree_len;
+        sum += stat.get_mean() * stat.get_count();
+        count += stat.get_count();
+    }
+    return count > 0 ? sum / count : 0;
+}
+
+/** Get the visit count of the root during a search.
+    In root-parallel mode, the visit counts of the root in the private trees
+    are only merged periodically, so the count is estimated from the number
+    of simulations. */
+template<class S, class M, class R>
+inline auto SearchBase<S, M, R>::get_current_root_count(
+        const ThreadState& thread_state) const -> Float
+{
+    if (m_trees_root_parallel)
+        return m_reused_count
+                + Float(m_nu_simulations.load(memory_order_relaxed));
+    return thread_state.tree->get_root().get_visit_count();
+}
+
 template<class S, class M, class R>
 inline size_t SearchBase<S, M, R>::get_nu_simulations() const
 {
@@ -899,14 +1326,14 @@ template<class S, class M, class R>
 inline S& SearchBase<S, M, R>::get_state(unsigned thread_id)
 {
     LIBBOARDGAME_ASSERT(thread_id < m_threads.size());
-    return *m_threads[thread_id]->thread_state.state;
+    return *m_threads[thread_id]->thread_state.slots[0].state;
 }
 
 template<class S, class M, class R>
 inline const S& SearchBase<S, M, R>::get_state(unsigned thread_id) const
 {
     LIBBOARDGAME_ASSERT(thread_id < m_threads.size());
-    return *m_threads[thread_id]->thread_state.state;
+    return *m_threads[thread_id]->thread_state.slots[0].state;
 }
 
 template<class S, class M, class R>
@@ -915,6 +1342,126 @@ inline auto SearchBase<S, M, R>::get_tree() const -> const Tree&
     return m_tree;
 }
 
+/** Initialize the private trees and root statistics in root-parallel mode.
+    The private trees of the other threads start with a copy of the root and
+    its children in m_tree. */
+template<class S, class M, class R>
+void SearchBase<S, M, R>::init_root_parallel(unsigned nu_threads)
+{
+    auto& root = m_tree.get_root();
+    m_root_stat.clear();
+    m_root_stat.push_back({0, 0, root.get_visit_count()});
+    for (auto& i : m_tree.get_root_children())
+        m_root_stat.push_back({i.get_value() * i.get_value_count(),
+                               i.get_value_count(), i.get_visit_count()});
+    for (unsigned i = 0; i < nu_threads; ++i)
+    {
+        auto& thread_state = m_threads[i]->thread_state;
+        if (i > 0)
+        {
+            auto& tree = *thread_state.tree;
+            tree.clear();
+            m_tree.copy_subtree(tree, tree.get_root(), root,
+                                numeric_limits<Float>::max());
+        }
+        thread_state.merged_stat = m_root_stat;
+        for (PlayerInt j = 0; j < m_nu_players; ++j)
+            thread_state.root_val[j].clear();
+        thread_state.last_merge_time = 0;
+        thread_state.prune_min_count = SearchParamConst::prune_count_start;
+    }
+}
+
+/** Pin a thread and let it first-touch its part of the tree.
+    Used if NUMA mode is enabled. Must be run in the thread itself directly
+    after the trees were allocated. */
+template<class S, class M, class R>
+void SearchBase<S, M, R>::init_thread_memory(ThreadState& thread_state)
+{
+    if (! libboardgame_base::pin_thread_to_cpu(thread_state.thread_id))
+        LIBBOARDGAME_LOG_THREAD(thread_state, "Thread pinning not supported");
+    thread_state.tree->touch_thread_storage(thread_state.storage_id);
+}
+
+template<class S, class M, class R>
+void SearchBase<S, M, R>::load_tree(const string& file)
+{
+    if (m_nu_threads != m_threads.size() || m_thread_pool != m_threads_pool)
+        create_threads();
+    if (m_root_parallel != m_trees_root_parallel || m_numa != m_trees_numa
+            || m_huge_pages != m_trees_huge_pages
+            || m_transpositions != m_trees_transpositions)
+        allocate_trees();
+    Tree tree(0, 1);
+    string user_data;
+    tree.load(file, user_data);
+    istringstream in(user_data);
+    array<pair<Float, Float>, max_players> root_val;
+    for (auto& i : root_val)
+        in >> i.first >> i.second;
+    if (! in)
+        throw runtime_error("invalid search tree file: " + file);
+    read_followup_info(in);
+    // The memory of the loaded tree is a mapping of the file, so the nodes
+    // are copied if the memory of m_tree was allocated with huge pages or
+    // placed on NUMA nodes
+    if (tree.get_nu_threads() == m_tree.get_nu_threads()
+            && tree.get_max_nodes() == m_tree.get_max_nodes()
+            && ! m_trees_huge_pages && ! m_trees_numa)
+    {
+        bool allow_shared_children = m_tree.get_allow_shared_children();
+        m_tree.swap(tree);
+        if (allow_shared_children)
+            m_tree.set_allow_shared_children(true);
+    }
+    else
+    {
+        LIBBOARDGAME_LOG("Copying loaded tree");
+        m_tree.clear();
+        tree.copy_subtree(m_tree, m_tree.get_root(), tree.get_root(), 0);
+    }
+    for (PlayerInt i = 0; i < max_players; ++i)
+        m_root_val[i].init(root_val[i].first, root_val[i].second);
+    m_abort = false;
+    m_is_tree_loaded = true;
+}
+
+/** Add the changes of the root statistics of a thread since its last merge
+    to the merged statistics in root-parallel mode. */
+template<class S, class M, class R>
+void SearchBase<S, M, R>::merge_root_stat(ThreadState& thread_state)
+{
+    auto& tree = *thread_state.tree;
+    auto& merged_stat = thread_state.merged_stat;
+    lock_guard lock(m_root_stat_mutex);
+    auto update = [&](size_t i, double wins, double value_count,
+                      double visit_count) {
+        auto& stat = merged_stat[i];
+        auto& root_stat = m_root_stat[i];
+        root_stat.wins += wins - stat.wins;
+        root_stat.value_count += value_count - stat.value_count;
+        root_stat.visit_count += visit_count - stat.visit_count;
+        stat = {wins, value_count, visit_count};
+    };
+    update(0, 0, 0, tree.get_root().get_visit_count());
+    auto children = tree.get_root_children();
+    LIBBOARDGAME_ASSERT(children.size() + 1 == merged_stat.size());
+    size_t i = 1;
+    for (auto& child : children)
+    {
+        Float value_count = child.get_value_count();
+        update(i++, child.get_value() * value_count, value_count,
+               child.get_visit_count());
+    }
+    for (PlayerInt j = 0; j < m_nu_players; ++j)
+    {
+        auto& root_val = thread_state.root_val[j];
+        if (root_val.get_count() > 0)
+            m_root_val[j].add(root_val.get_mean(), root_val.get_count());
+        root_val.clear();
+    }
+}
+
 template<class S, class M, class R>
 void SearchBase<S, M, R>::on_start_search([[maybe_unused]] bool is_followup)
 {
@@ -922,11 +1469,32 @@ void SearchBase<S, M, R>::on_start_search([[maybe_unused]] bool is_followup)
 }
 
 template<class S, class M, class R>
-void SearchBase<S, M, R>::playout(ThreadState& thread_state)
+void SearchBase<S, M, R>::parallel_for(unsigned n,
+                                       const function<void(unsigned)>& func)
 {
-    auto& state = *thread_state.state;
+    if (n == 0)
+        return;
+    auto nu_threads = min(n, static_cast<unsigned>(m_threads.size()));
+    if (nu_threads <= 1)
+    {
+        for (unsigned i = 0; i < n; ++i)
+            func(i);
+        return;
+    }
+    atomic<unsigned> next(0);
+    typename Thread::SearchFunc thread_func = [&](ThreadState&) {
+        for (auto i = next.fetch_add(1); i < n; i = next.fetch_add(1))
+            func(i);
+    };
+    run_threads(nu_threads, thread_func);
+}
+
+template<class S, class M, class R>
+void SearchBase<S, M, R>::playout(SimulationSlot& slot)
+{
+    auto& state = *slot.state;
     state.start_playout();
-    auto& simulation = thread_state.simulation;
+    auto& simulation = slot.simulation;
     auto& moves = simulation.moves;
     auto nu_moves = moves.size();
     Move last = nu_moves > 0 ? moves[nu_moves - 1].move : Move::null();
@@ -942,21 +1510,23 @@ void SearchBase<S, M, R>::playout(ThreadState& thread_state)
 }
 
 template<class S, class M, class R>
-void SearchBase<S, M, R>::play_in_tree(ThreadState& thread_state)
+void SearchBase<S, M, R>::play_in_tree(ThreadState& thread_state,
+                                       SimulationSlot& slot)
 {
-    auto& state = *thread_state.state;
-    auto& simulation = thread_state.simulation;
+    auto& state = *slot.state;
+    auto& simulation = slot.simulation;
+    auto& tree = *thread_state.tree;
     simulation.nodes.resize(1);
     simulation.moves.clear();
-    auto& root = m_tree.get_root();
+    auto& root = tree.get_root();
     auto node = &root;
     Float expansion_threshold = SearchParamConst::expansion_threshold;
     typename Tree::Children children;
-    while (! (children = m_tree.get_children(*node)).empty())
+    while (! (children = tree.get_children(*node)).empty())
     {
         node = select_child(*node, children);
-        if (multithread && SearchParamConst::virtual_loss)
-            m_tree.add_value(*node, 0);
+        if (m_virtual_loss)
+            tree.add_value(*node, 0);
         simulation.nodes.push_back(node);
         Move mv = node->get_move();
         simulation.moves.push_back({state.get_player(), mv});
@@ -966,9 +1536,12 @@ void SearchBase<S, M, R>::play_in_tree(ThreadState& thread_state)
     state.finish_in_tree();
     if (node->get_visit_count() > expansion_threshold && node->is_unexpanded())
     {
-        m_tree.set_expanding(*node);
-        if (! expand_node(thread_state, *node, node))
+        tree.set_expanding(*node);
+        if (! expand_node(thread_state, state, *node, node))
+        {
+            tree.set_unexpanded(*node);
             thread_state.is_out_of_mem = true;
+        }
         else if (node)
         {
             simulation.nodes.push_back(node);
@@ -980,6 +1553,14 @@ void SearchBase<S, M, R>::play_in_tree(ThreadState& thread_state)
     thread_state.stat_in_tree_len.add(double(simulation.moves.size()));
 }
 
+template<class S, class M, class R>
+string SearchBase<S, M, R>::page_size_to_string(size_t page_size)
+{
+    if (page_size >= (1 << 20))
+        return to_string(page_size >> 20) + "M";
+    return to_string(page_size >> 10) + "K";
+}
+
 template<class S, class M, class R>
 string SearchBase<S, M, R>::get_info() const
 {
@@ -997,7 +1578,12 @@ string SearchBase<S, M, R>::get_info() const
         s << setprecision(1) << ", Chld "
           << (100 * child->get_visit_count() / root.get_visit_count())
           << '%';
-    s << "\nNds " << m_tree.get_nu_nodes()
+    auto nu_nodes = m_tree.get_nu_nodes();
+    for (auto& i : m_threads)
+        if (i->thread_state.private_tree)
+            nu_nodes += i->thread_state.private_tree->get_nu_nodes();
+    s << "\nNds " << nu_nodes
+      << ", Pg " << page_size_to_string(m_tree.get_page_size())
       << ", Tm " << time_to_string(m_last_time)
       << setprecision(0) << ", Sim/s "
       << (double(m_nu_simulations) / m_last_time)
@@ -1013,29 +1599,41 @@ string SearchBase<S, M, R>::get_info_ext() const
     return {};
 }
 
+/** Prune the tree of a thread that could not expand a node.
+    In the shared tree, the other threads continue searching during the
+    pruning. The memory of the pruned subtrees becomes available after all
+    threads have finished the simulation that they were running during the
+    pruning, so pruning is skipped while memory of the last pruning is still
+    waiting to be reclaimed or while another thread is pruning. */
 template<class S, class M, class R>
-bool SearchBase<S, M, R>::prune(
-        TimeSource& time_source, [[maybe_unused]] double time,
-        Float prune_min_count, Float& new_prune_min_count)
+void SearchBase<S, M, R>::prune(ThreadState& thread_state)
 {
-    Timer timer(time_source);
-    m_tmp_tree.clear();
-    m_tree.copy_subtree(m_tmp_tree, m_tmp_tree.get_root(), m_tree.get_root(),
-                        prune_min_count);
-    auto percent = int(m_tmp_tree.get_nu_nodes() * 100 / m_tree.get_nu_nodes());
-    LIBBOARDGAME_LOG("Pruning MinCnt: ", prune_min_count, ", AtTm: ", time,
-                     ", Nds: ", m_tmp_tree.get_nu_nodes(), " (", percent,
-                     "%), Tm: ", timer());
-    m_tree.swap(m_tmp_tree);
-    if (percent > 50)
+    auto& tree = *thread_state.tree;
+    unique_lock lock(m_prune_mutex, defer_lock);
+    auto min_count = &thread_state.prune_min_count;
+    if (! m_trees_root_parallel)
     {
-        if (prune_min_count >= 0.5f * numeric_limits<Float>::max())
-            return false;
-        new_prune_min_count = prune_min_count * 2;
-        return true;
+        if (! lock.try_lock())
+            return;
+        min_count = &m_prune_min_count;
     }
-    new_prune_min_count = prune_min_count;
-    return true;
+    if (tree.has_pending(thread_state.storage_id))
+        return;
+    Timer timer(*m_time_source);
+    // Children found in the transposition table could be linked to nodes
+    // that are not seen by prune() anymore
+    bool use_tt = (m_tt && &tree == &m_tree);
+    if (use_tt)
+        m_tt->begin_invalidate();
+    auto nu_freed = tree.prune(*min_count);
+    if (use_tt)
+        m_tt->end_invalidate();
+    auto percent = int(nu_freed * 100 / tree.get_max_nodes());
+    LIBBOARDGAME_LOG_THREAD(thread_state, "Pruning MinCnt: ", *min_count,
+                            ", AtTm: ", m_timer(), ", Freed: ", nu_freed,
+                            " (", percent, "%), Tm: ", timer());
+    if (percent < 50 && *min_count < 0.5f * numeric_limits<Float>::max())
+        *min_count *= 2;
 }
 
 /** Estimate the value and count of a root node from its children.
@@ -1062,16 +1660,39 @@ bool SearchBase<S, M, R>::estimate_reused_root_val(Tree& tree,
     return count > 0;
 }
 
+template<class S, class M, class R>
+void SearchBase<S, M, R>::read_followup_info([[maybe_unused]] istream& in)
+{
+    // Default implementation does nothing
+}
+
+template<class S, class M, class R>
+void SearchBase<S, M, R>::save_tree(const string& file) const
+{
+    ostringstream out;
+    out.precision(numeric_limits<Float>::max_digits10);
+    for (auto& i : m_root_val)
+        out << i.get_mean() << ' ' << i.get_count() << '\n';
+    write_followup_info(out);
+    m_tree.save(file, out.str());
+}
+
 template<class S, class M, class R>
 bool SearchBase<S, M, R>::search(Move& mv, Float max_count,
                                  size_t min_simulations, double max_time,
                                  TimeSource& time_source)
 {
-    if (m_nu_threads != m_threads.size())
+    if (m_nu_threads != m_threads.size() || m_thread_pool != m_threads_pool)
         create_threads();
+    if (m_root_parallel != m_trees_root_parallel || m_numa != m_trees_numa
+            || m_huge_pages != m_trees_huge_pages
+            || m_transpositions != m_trees_transpositions)
+        allocate_trees();
     m_deterministic = RandomGenerator::has_global_seed();
     bool is_followup = check_followup(m_followup_sequence);
-    on_start_search(is_followup);
+    bool is_tree_loaded = m_is_tree_loaded;
+    m_is_tree_loaded = false;
+    on_start_search(is_followup && ! is_tree_loaded);
     if (max_count > 0)
         // A fixed number of simulations means that no time limit is used, but
         // max_time is still used at some places in the code, so we set it to
@@ -1103,35 +1724,35 @@ bool SearchBase<S, M, R>::search(Move& mv, Float max_count,
         if (m_followup_sequence.empty())
         {
             if (tree_nodes > 1)
+            {
                 LIBBOARDGAME_LOG("Reusing all ", tree_nodes, " nodes (count=",
                                  m_tree.get_root().get_visit_count(), ")");
+                clear_tree = false;
+            }
         }
         else
         {
             Timer timer(time_source);
-            m_tmp_tree.clear();
             auto node = find_node(m_tree, m_followup_sequence);
             if (node)
             {
-                m_tree.extract_subtree(m_tmp_tree, *node);
-                auto& tmp_tree_root = m_tmp_tree.get_root();
+                m_tree.make_root(*node);
+                auto& root = m_tree.get_root();
                 if (! is_same)
                 {
                     Float value, count;
-                    if (estimate_reused_root_val(m_tmp_tree, tmp_tree_root,
-                                                 value, count))
+                    if (estimate_reused_root_val(m_tree, root, value, count))
                         m_root_val[m_player].add(value, count);
                 }
-                size_t tmp_tree_nodes = m_tmp_tree.get_nu_nodes();
-                if (tree_nodes > 1 && tmp_tree_nodes > 1)
+                size_t reused_nodes = m_tree.get_nu_nodes();
+                if (tree_nodes > 1 && reused_nodes > 1)
                 {
                     double time = timer();
-                    LIBBOARDGAME_LOG("Reusing ", tmp_tree_nodes, " nodes (",
+                    LIBBOARDGAME_LOG("Reusing ", reused_nodes, " nodes (",
                                      std::fixed, setprecision(1),
-                                     100 * double(tmp_tree_nodes)
+                                     100 * double(reused_nodes)
                                      / double(tree_nodes),
                                      "% tm=", setprecision(4), time, ")");
-                    m_tree.swap(m_tmp_tree);
                     clear_tree = false;
                     max_time -= time;
                     if (max_time < 0)
@@ -1142,27 +1763,45 @@ bool SearchBase<S, M, R>::search(Move& mv, Float max_count,
     }
     if (clear_tree)
         m_tree.clear();
+    // The table only contains nodes of the tree of the last search, which
+    // were freed or are only kept in the subtree of a new root
+    if (m_tt)
+        m_tt->invalidate();
 
     m_timer.reset(time_source);
     m_time_source = &time_source;
     m_abort = false;
-    if (SearchParamConst::use_lgr && ! is_followup)
+    if (SearchParamConst::use_lgr && (! is_followup || is_tree_loaded))
         m_lgr.init(m_nu_players);
     for (auto& i : m_threads)
     {
         auto& thread_state = i->thread_state;
         thread_state.stat_len.clear();
         thread_state.stat_in_tree_len.clear();
-        thread_state.state->start_search();
+        for (auto& slot : thread_state.slots)
+            slot.state->start_search();
     }
     m_max_count = max_count;
     m_min_simulations = min_simulations;
     m_max_time = max_time;
+    m_time_limit.store(max_time, memory_order_relaxed);
+    m_stable_best = numeric_limits<size_t>::max();
+    m_best_change_time = 0;
+    m_val_ref_time = -1;
+    m_val_change = 0;
     m_nu_simulations.store(0);
-    Float prune_min_count = SearchParamConst::prune_count_start;
-
-    // Don't use multi-threading for very short searches (less than 0.5s).
+    m_prune_min_count = SearchParamConst::prune_count_start;
+    // Virtual losses are needed if several simulations run in the same tree
+    // concurrently, either in different threads or in the same batch
+    m_virtual_loss =
+            SearchParamConst::virtual_loss
+            && ((multithread && ! m_trees_root_parallel) || m_batch_size > 1);
+
+    // Don't use multi-threading for very short searches (less than 0.05s),
+    // in which the start and end of the threads would take a significant
+    // part of the time.
     auto reused_count = m_tree.get_root().get_visit_count();
+    m_reused_count = reused_count;
     unsigned nu_threads = m_nu_threads;
     double expected_time;
     if (max_count > 0)
@@ -1171,20 +1810,23 @@ bool SearchBase<S, M, R>::search(Move& mv, Float max_count,
                 / SearchParamConst::expected_sim_per_sec;
     else
         expected_time = max_time;
-    if (nu_threads > 1 && expected_time < 0.5)
+    if (nu_threads > 1 && expected_time < 0.05)
     {
         LIBBOARDGAME_LOG("Using single-threading for short search");
         nu_threads = 1;
     }
 
     auto& thread_state_0 = m_threads[0]->thread_state;
+    typename Thread::SearchFunc search_func =
+            bind(&SearchBase::search_loop, this, placeholders::_1);
     auto& root = m_tree.get_root();
     if (root.get_nu_children() <= 0)
     {
         const Node* best_child;
-        thread_state_0.state->start_simulation(0);
-        thread_state_0.state->finish_in_tree();
-        expand_node(thread_state_0, root, best_child);
+        auto& state = *thread_state_0.slots[0].state;
+        state.start_simulation(0);
+        state.finish_in_tree();
+        expand_node(thread_state_0, state, root, best_child);
     }
 
     auto nu_children = root.get_nu_children();
@@ -1192,26 +1834,25 @@ bool SearchBase<S, M, R>::search(Move& mv, Float max_count,
         LIBBOARDGAME_LOG("No legal moves at root");
     else if (nu_children == 1 && min_simulations == 0)
         LIBBOARDGAME_LOG("Root has only one child");
-    else
-        while (true)
+    else if (m_trees_root_parallel)
+    {
+        init_root_parallel(nu_threads);
+        run_threads(nu_threads, search_func);
+        for (unsigned i = 0; i < nu_threads; ++i)
+            merge_root_stat(m_threads[i]->thread_state);
+        m_tree.set_visit_count(root, Float(m_root_stat[0].visit_count));
+        size_t i = 1;
+        for (auto& child : m_tree.get_root_children())
         {
-            for (unsigned i = 1; i < nu_threads; ++i)
-                m_threads[i]->start_search();
-            search_loop(thread_state_0);
-            for (unsigned i = 1; i < nu_threads; ++i)
-                m_threads[i]->wait_search_finished();
-            bool is_out_of_mem = false;
-            for (unsigned i = 0; i < nu_threads; ++i)
-                if (m_threads[i]->thread_state.is_out_of_mem)
-                {
-                    is_out_of_mem = true;
-                    break;
-                }
-            if (! is_out_of_mem)
-                break;
-            double time = m_timer();
-            prune(time_source, time, prune_min_count, prune_min_count);
+            auto& stat = m_root_stat[i++];
+            if (stat.value_count > 0)
+                m_tree.set_value(child, Float(stat.wins / stat.value_count),
+                                 Float(stat.value_count));
+            m_tree.set_visit_count(child, Float(stat.visit_count));
         }
+    }
+    else
+        run_threads(nu_threads, search_func);
 
     m_last_time = m_timer();
     LIBBOARDGAME_LOG(get_info());
@@ -1220,13 +1861,38 @@ bool SearchBase<S, M, R>::search(Move& mv, Float max_count,
     return result;
 }
 
+/** Run a function for the first threads and wait until it finished.
+    The function is run for thread 0 in the current thread. */
+template<class S, class M, class R>
+void SearchBase<S, M, R>::run_threads(unsigned nu_threads,
+                                      const typename Thread::SearchFunc& func)
+{
+    LIBBOARDGAME_ASSERT(nu_threads > 0 && nu_threads <= m_threads.size());
+    if (m_thread_pool)
+    {
+        TaskGroup group(*m_thread_pool);
+        for (unsigned i = 1; i < nu_threads; ++i)
+            group.run([&, i] { func(m_threads[i]->thread_state); });
+        func(m_threads[0]->thread_state);
+        group.wait();
+        return;
+    }
+    for (unsigned i = 1; i < nu_threads; ++i)
+        m_threads[i]->start_func(func);
+    func(m_threads[0]->thread_state);
+    for (unsigned i = 1; i < nu_threads; ++i)
+        m_threads[i]->wait_search_finished();
+}
+
 template<class S, class M, class R>
 void SearchBase<S, M, R>::search_loop(ThreadState& thread_state)
 {
-    auto& state = *thread_state.state;
-    auto& simulation = thread_state.simulation;
-    simulation.nodes.assign(&m_tree.get_root());
-    simulation.moves.clear();
+    auto& slots = thread_state.slots;
+    for (auto& slot : slots)
+    {
+        slot.simulation.nodes.assign(&thread_state.tree->get_root());
+        slot.simulation.moves.clear();
+    }
     double time_interval = 0.1;
     if (m_max_count == 0 && m_max_time < 1)
         time_interval = 0.1 * m_max_time;
@@ -1241,24 +1907,40 @@ void SearchBase<S, M, R>::search_loop(ThreadState& thread_state)
                     max(1.0, SearchParamConst::expected_sim_per_sec / 5.0));
         expensive_abort_checker.set_deterministic(interval);
     }
+    auto& tree = *thread_state.tree;
+    auto storage_id = thread_state.storage_id;
     while (true)
     {
         thread_state.is_out_of_mem = false;
         if ((check_abort(thread_state) || expensive_abort_checker())
                 && m_nu_simulations >= m_min_simulations)
             break;
-        state.start_simulation(m_nu_simulations.fetch_add(1));
-        play_in_tree(thread_state);
+        tree.begin_access(storage_id);
+        for (auto& slot : slots)
+        {
+            slot.state->start_simulation(m_nu_simulations.fetch_add(1));
+            play_in_tree(thread_state, slot);
+        }
+        // Nodes of the batch unlinked by prune() stay valid until
+        // end_access()
         if (thread_state.is_out_of_mem)
-            break;
-        playout(thread_state);
-        state.evaluate_playout(simulation.eval);
-        thread_state.stat_len.add(double(simulation.moves.size()));
-        update_values(thread_state);
-        if (SearchParamConst::rave)
-            update_rave(thread_state);
+            prune(thread_state);
+        for (auto& slot : slots)
+        {
+            playout(slot);
+            slot.state->evaluate_playout(slot.simulation.eval);
+            thread_state.stat_len.add(double(slot.simulation.moves.size()));
+        }
+        for (auto& slot : slots)
+        {
+            update_values(thread_state, slot.simulation);
+            if (SearchParamConst::rave)
+                update_rave(thread_state, slot);
+        }
+        tree.end_access(storage_id);
         if (SearchParamConst::use_lgr)
-            update_lgr(thread_state);
+            for (auto& slot : slots)
+                update_lgr(slot.simulation);
     }
 }
 
@@ -1340,6 +2022,28 @@ bool SearchBase<S, M, R>::select_move(Move& mv) const
     return false;
 }
 
+template<class S, class M, class R>
+void SearchBase<S, M, R>::set_adaptive_time(double max_factor)
+{
+    LIBBOARDGAME_ASSERT(max_factor == 0 || max_factor >= 1);
+    m_adaptive_time = max_factor;
+}
+
+template<class S, class M, class R>
+void SearchBase<S, M, R>::set_batch_size(unsigned n)
+{
+    LIBBOARDGAME_ASSERT(n > 0);
+    m_batch_size = n;
+    for (auto& i : m_threads)
+    {
+        auto& slots = i->thread_state.slots;
+        auto old_size = slots.size();
+        slots.resize(n);
+        for (auto j = old_size; j < n; ++j)
+            slots[j].state = create_state();
+    }
+}
+
 template<class S, class M, class R>
 void SearchBase<S, M, R>::set_callback(
         const function<void(double, double)>& callback)
@@ -1378,9 +2082,8 @@ void SearchBase<S, M, R>::set_reuse_tree(bool enable)
 }
 
 template<class S, class M, class R>
-void SearchBase<S, M, R>::update_lgr(ThreadState& thread_state)
+void SearchBase<S, M, R>::update_lgr(const Simulation& simulation)
 {
-    const auto& simulation = thread_state.simulation;
     auto& eval = simulation.eval;
     auto max_eval = eval[0];
     for (PlayerInt i = 1; i < m_nu_players; ++i)
@@ -1412,16 +2115,18 @@ void SearchBase<S, M, R>::update_lgr(ThreadState& thread_state)
 }
 
 template<class S, class M, class R>
-void SearchBase<S, M, R>::update_rave(ThreadState& thread_state)
+void SearchBase<S, M, R>::update_rave(ThreadState& thread_state,
+                                      const SimulationSlot& slot)
 {
-    const auto& state = *thread_state.state;
-    auto& moves = thread_state.simulation.moves;
+    const auto& state = *slot.state;
+    auto& tree = *thread_state.tree;
+    auto& moves = slot.simulation.moves;
     auto nu_moves = static_cast<unsigned>(moves.size());
     if (nu_moves == 0)
         return;
     auto& was_played = thread_state.was_played;
     auto& first_play = thread_state.first_play;
-    auto& nodes = thread_state.simulation.nodes;
+    auto& nodes = slot.simulation.nodes;
     auto nu_nodes = static_cast<unsigned>(nodes.size());
     unsigned i = nu_moves - 1;
     // nu_nodes is at least 2 (including root) because the case of no legal
@@ -1449,7 +2154,7 @@ void SearchBase<S, M, R>::update_rave(ThreadState& thread_state)
         Float dist_factor;
         if (SearchParamConst::rave_dist_weighting)
             dist_factor = 1 / static_cast<Float>(nu_moves - i);
-        for (auto& it : m_tree.get_children(*node))
+        for (auto& it : tree.get_children(*node))
         {
             auto mv = it.get_move();
             if (was_played[mv.to_int()] != player
@@ -1460,7 +2165,7 @@ void SearchBase<S, M, R>::update_rave(ThreadState& thread_state)
             Float weight = m_rave_weight;
             if (SearchParamConst::rave_dist_weighting)
                 weight *= 1 - static_cast<Float>(first - i) * dist_factor;
-            m_tree.add_value(it, thread_state.simulation.eval[player], weight);
+            tree.add_value(it, slot.simulation.eval[player], weight);
         }
         if (i == 0)
             break;
@@ -1478,18 +2183,19 @@ void SearchBase<S, M, R>::update_rave(ThreadState& thread_state)
 }
 
 template<class S, class M, class R>
-void SearchBase<S, M, R>::update_values(ThreadState& thread_state)
+void SearchBase<S, M, R>::update_values(ThreadState& thread_state,
+                                        const Simulation& simulation)
 {
-    const auto& simulation = thread_state.simulation;
+    auto& tree = *thread_state.tree;
     auto& nodes = simulation.nodes;
     auto& eval = simulation.eval;
     auto nu_nodes = static_cast<unsigned>(nodes.size());
-    m_tree.inc_visit_count(*nodes[0]);
+    tree.inc_visit_count(*nodes[0]);
     for (unsigned i = 1; i < nu_nodes; ++i)
     {
         auto& node = *nodes[i];
         auto mv = simulation.moves[i - 1];
-        if (multithread && SearchParamConst::virtual_loss)
+        if (m_virtual_loss)
             // Note that this could become problematic if the number of threads
             // is large. The lock-free algorithm intentionally ignores lost or
             // partial updates to run faster. But the probability that adding
@@ -1497,13 +2203,69 @@ void SearchBase<S, M, R>::update_values(ThreadState& thread_state)
             // lost because the removal is done in this function with many
             // calls to add_value() but the adding is done in play_in_tree().
             // This could introduce a systematic error.
-            m_tree.add_value_remove_loss(node, eval[mv.player]);
+            tree.add_value_remove_loss(node, eval[mv.player]);
         else
-            m_tree.add_value(node, eval[mv.player]);
-        m_tree.inc_visit_count(node);
+            tree.add_value(node, eval[mv.player]);
+        tree.inc_visit_count(node);
     }
+    auto& root_val = (m_trees_root_parallel ?
+                      thread_state.root_val : m_root_val);
     for (PlayerInt i = 0; i < m_nu_players; ++i)
-        m_root_val[i].add(eval[i]);
+        root_val[i].add(eval[i]);
+}
+
+/** Adapt the time limit of the current search to its stability.
+    See set_adaptive_time(). Only called in thread 0. */
+template<class S, class M, class R>
+void SearchBase<S, M, R>::update_time_limit(
+        [[maybe_unused]] ThreadState& thread_state, double time)
+{
+    Float max_wins;
+    Float second_max;
+    size_t best;
+    get_max_wins(max_wins, second_max, best);
+    if (best != m_stable_best)
+    {
+        m_stable_best = best;
+        m_best_change_time = time;
+    }
+    auto& root_val = m_root_val[m_player];
+    if (m_val_ref_time < 0)
+    {
+        m_val_ref = root_val.get_mean();
+        m_val_ref_time = time;
+    }
+    else if (time - m_val_ref_time >= 0.5 * m_max_time)
+    {
+        m_val_change = abs(root_val.get_mean() - m_val_ref);
+        m_val_ref = root_val.get_mean();
+        m_val_ref_time = time;
+    }
+    auto old_limit = m_time_limit.load(memory_order_relaxed);
+    double limit = m_max_time;
+    if (time >= 0.25 * m_max_time && root_val.get_count() > 100
+            && max_wins >= 4 * second_max)
+    {
+        if (time < m_max_time)
+            LIBBOARDGAME_LOG_THREAD(thread_state, "Best move dominates");
+        limit = time;
+    }
+    else if (time >= m_max_time
+             && (time - m_best_change_time < 0.25 * m_max_time
+                 || m_val_change > 0.02f))
+    {
+        limit = m_adaptive_time * m_max_time;
+        if (old_limit <= m_max_time)
+            LIBBOARDGAME_LOG_THREAD(thread_state, "Extending unstable search");
+    }
+    m_time_limit.store(limit, memory_order_relaxed);
+}
+
+template<class S, class M, class R>
+void SearchBase<S, M, R>::write_followup_info(
+        [[maybe_unused]] ostream& out) const
+{
+    // Default implementation does nothing
 }
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,208 @@
+//-----------------------------------------------------------------------------
+/** @file libboardgame_mcts/TranspositionTable.h
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#ifndef LIBBOARDGAME_MCTS_TRANSPOSITION_TABLE_H
+#define LIBBOARDGAME_MCTS_TRANSPOSITION_TABLE_H
+
+#include <cstdint>
+#include <memory>
+#include "Atomic.h"
+#include "Node.h"
+
+namespace libboardgame_mcts {
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+/** Hash table that maps positions to the children of an expanded node.
+    Used for sharing the children between nodes of the search tree that
+    correspond to the same position reached by different move sequences,
+    which turns the tree into a directed acyclic graph.<p>
+    The table can be used by multiple threads without locking. An entry
+    consists of two words, the hash is stored XOR'ed with the data, so that
+    an entry that was read while another thread was writing it is detected
+    as a miss (Hyatt, Mann: A lock-less transposition table implementation
+    for parallel search chess engines. 2002). Entries are replaced without
+    checking.<p>
+    All entries are invalidated at once by incrementing a generation
+    counter, which is stored in each entry. The generation is odd during
+    the invalidation (e.g. while a subtree is pruned), entries are neither
+    found nor stored in this time. A caller that links a node to the
+    children found in the table must check with get_generation() after
+    linking that the table was not invalidated in the meantime. Similarly,
+    a caller that stores new children must pass the generation read before
+    linking them, see store().
+    @tparam MT Whether the table is used in a multi-threaded search. */
+template<bool MT>
+class TranspositionTable
+{
+public:
+    /** Constructor.
+        @param size The number of entries, rounded down to a power of two.
+        Zero creates an empty table that never finds an entry. */
+    explicit TranspositionTable(size_t size = 0);
+
+    /** Find the children stored for a position.
+        @param hash The hash of the position.
+        @param[out] first_child
+        @param[out] nu_children
+        @param[out] generation The generation of the table at the time of
+        the lookup.
+        @return @c true if an entry was found. */
+    bool lookup(uint_least64_t hash, NodeIdx& first_child,
+                unsigned& nu_children, uint_least32_t& generation) const;
+
+    /** Store the children of a position.
+        Does nothing while the table is being invalidated or if it was
+        invalidated since the children were linked, because the children
+        might have been freed by a concurrent prune that did not see the
+        link.
+        @param hash The hash of the position.
+        @param first_child
+        @param nu_children
+        @param generation The generation of the table read with
+        get_generation() before the children were linked. */
+    void store(uint_least64_t hash, NodeIdx first_child,
+               unsigned nu_children, uint_least32_t generation);
+
+    /** Start invalidating all entries.
+        Must not be called by more than one thread at a time. */
+    void begin_invalidate();
+
+    /** Finish invalidating all entries. */
+    void end_invalidate();
+
+    /** Invalidate all entries.
+        Equivalent to begin_invalidate() followed by end_invalidate(). */
+    void invalidate();
+
+    uint_least32_t get_generation() const;
+
+    size_t get_size() const { return m_mask == 0 ? 0 : m_mask + 1; }
+
+private:
+    struct Entry
+    {
+        Atomic<uint_least64_t, MT> key;
+
+        Atomic<uint_least64_t, MT> data;
+    };
+
+    size_t m_mask = 0;
+
+    unique_ptr<Entry[]> m_entries;
+
+    Atomic<uint_least32_t, MT> m_generation;
+};
+
+template<bool MT>
+TranspositionTable<MT>::TranspositionTable(size_t size)
+{
+    m_generation.store(2);
+    if (size == 0)
+        return;
+    size_t n = 1;
+    while (2 * n <= size)
+        n *= 2;
+    m_mask = n - 1;
+    m_entries = make_unique<Entry[]>(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        m_entries[i].key.store(0, memory_order_relaxed);
+        m_entries[i].data.store(0, memory_order_relaxed);
+    }
+}
+
+template<bool MT>
+void TranspositionTable<MT>::begin_invalidate()
+{
+    m_generation.fetch_add(1);
+    // Make sure that threads that linked to children found in the table
+    // either see the new generation or their links are visible to the
+    // caller after this function
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+template<bool MT>
+void TranspositionTable<MT>::end_invalidate()
+{
+    auto generation = m_generation.load(memory_order_relaxed) + 1;
+    // Only the lower 16 bits of the generation are stored in the entries, so
+    // old entries would become valid again after a wrap-around
+    if ((generation & 0xffff) == 0)
+        for (size_t i = 0; i < get_size(); ++i)
+        {
+            m_entries[i].key.store(0, memory_order_relaxed);
+            m_entries[i].data.store(0, memory_order_relaxed);
+        }
+    m_generation.store(generation);
+}
+
+template<bool MT>
+inline uint_least32_t TranspositionTable<MT>::get_generation() const
+{
+    return m_generation.load(memory_order_seq_cst);
+}
+
+template<bool MT>
+void TranspositionTable<MT>::invalidate()
+{
+    begin_invalidate();
+    end_invalidate();
+}
+
+template<bool MT>
+bool TranspositionTable<MT>::lookup(uint_least64_t hash, NodeIdx& first_child,
+                                    unsigned& nu_children,
+                                    uint_least32_t& generation) const
+{
+    if (m_mask == 0)
+        return false;
+    generation = m_generation.load(memory_order_seq_cst);
+    if ((generation & 1) != 0)
+        return false;
+    auto& entry = m_entries[hash & m_mask];
+    auto data = entry.data.load(memory_order_acquire);
+    auto key = entry.key.load(memory_order_relaxed);
+    if ((key ^ data) != hash || (data & 0xffff) != (generation & 0xffff))
+        return false;
+    nu_children = static_cast<unsigned>((data >> 16) & 0xffff);
+    first_child = static_cast<NodeIdx>(data >> 32);
+    return nu_children > 0;
+}
+
+template<bool MT>
+void TranspositionTable<MT>::store(uint_least64_t hash, NodeIdx first_child,
+                                   unsigned nu_children,
+                                   uint_least32_t generation)
+{
+    if (m_mask == 0 || (generation & 1) != 0
+            || m_generation.load(memory_order_seq_cst) != generation)
+        return;
+    auto data = (static_cast<uint_least64_t>(first_child) << 32)
+            | (static_cast<uint_least64_t>(nu_children) << 16)
+            | (generation & 0xffff);
+    auto& entry = m_entries[hash & m_mask];
+    entry.key.store(hash ^ data, memory_order_relaxed);
+    // Release, such that a thread that finds the entry sees the children
+    entry.data.store(data, memory_order_release);
+    // The entry is already invalid if the table was invalidated while it was
+    // written, but it could become valid again after a wrap-around of the
+    // stored part of the generation, so it is cleared
+    if (m_generation.load(memory_order_seq_cst) != generation
+            && entry.data.load(memory_order_relaxed) == data)
+    {
+        entry.key.store(0, memory_order_relaxed);
+        entry.data.store(0, memory_order_relaxed);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+} // namespace libboardgame_mcts
+
+#endif // LIBBOARDGAME_MCTS_TRANSPOSITION_TABLE_H
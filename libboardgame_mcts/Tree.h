@@ -8,8 +8,20 @@
 #define LIBBOARDGAME_MCTS_TREE_H
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include "Node.h"
+#include "libboardgame_base/Memory.h"
+#include "libboardgame_base/Range.h"
 
 namespace libboardgame_mcts {
 
@@ -25,7 +37,20 @@ using libboardgame_base::Range;
     The tree uses separate parts of the node storage for different threads,
     so it can be used without locking in multi-threaded search. Not all
     functions are thread-safe, only the ones that are used during a search
-    (e.g. expanding a node is thread-safe, but clear() is not) */
+    (e.g. expanding a node is thread-safe, but clear() is not).<p>
+    Subtrees can be pruned with prune() while other threads are still using
+    the tree. The memory of pruned subtrees is reused only after all threads
+    that could still reference the nodes have finished their current access
+    to the tree, as marked with begin_access() and end_access()
+    (quiescent-state-based reclamation). Each thread storage reuses freed
+    blocks of children when its unused memory is exhausted.<p>
+    Optionally, nodes can share the children of other nodes (see
+    link_shared_children()), which turns the tree into a directed acyclic
+    graph. prune() and make_root() do not free children that are still
+    reachable from another node in this case.<p>
+    The tree can be saved to a file with save() in a binary format that
+    load() maps directly into memory, so a search can be continued later
+    without rebuilding the tree. */
 template<typename N>
 class Tree
 {
@@ -65,8 +90,12 @@ public:
                      Float max_move_prior);
 
         /** Check if the tree still has the capacity for a given number
-            of children. */
-        bool check_capacity(unsigned short nu_children) const;
+            of children.
+            Must be called before adding the first child. If there is not
+            enough unused memory left, this reserves a block of freed nodes,
+            which is returned to the thread storage in link_children() as
+            far as it was not used. */
+        bool check_capacity(unsigned short nu_children);
 
         /** Add new child.
             It needs to be checked first with check_capacity() that the tree
@@ -85,11 +114,19 @@ public:
         const Node* get_best_child() const;
 
     private:
+        Tree& m_tree;
+
         ThreadStorage& m_thread_storage;
 
         Float m_best_move_prior = -numeric_limits<Float>::max();
 
-        const Node* m_first_child;
+        Node* m_first_child;
+
+        Node* m_next;
+
+        Node* m_end;
+
+        bool m_is_free_block = false;
 
         const Node* m_best_child;
 
@@ -100,27 +137,99 @@ public:
 #endif
     };
 
-    Tree(size_t memory, unsigned nu_threads);
+    /** Constructor.
+        @param memory The memory for the nodes in bytes.
+        @param nu_threads The number of threads that use the tree.
+        @param huge_pages Try to use huge pages for the nodes (see
+        libboardgame_base::PageMemory). */
+    Tree(size_t memory, unsigned nu_threads, bool huge_pages = false);
 
 
     /** Remove all nodes but the root node. */
     void clear();
 
+    /** Mark the start of an access to the nodes by a thread.
+        Pointers to nodes may only be kept between begin_access() and
+        end_access() because nodes of pruned subtrees can be reused after
+        that. Only needed if prune() is called during a search. */
+    void begin_access(unsigned thread_id);
+
+    void end_access(unsigned thread_id);
+
+    /** Remove the children of all nodes below a minimum count.
+        This function may be called by one thread at a time while other
+        threads are using the tree. The root and its children are always
+        kept. Blocks of children that were linked to a pruned subtree at the
+        same time as it was pruned can get lost until the next make_root()
+        or clear().
+        @return The number of nodes freed. */
+    size_t prune(Float min_count);
+
+    /** Like prune(min_count) but calls a function after the nodes to keep
+        were determined and before any node is unlinked (for testing purposes
+        only).
+        Allows to simulate other threads that change the tree while it is
+        pruned. */
+    size_t prune(Float min_count, const function<void()>& after_mark);
+
+    /** Make a node the new root, keeping its subtree in place.
+        All nodes not in the subtree of the node are freed, including blocks
+        lost during a prune(). Not thread-safe.
+        Note that you still have to re-initialize the value of the new root
+        because the value of the root node and the values of inner nodes have
+        a different meaning. */
+    void make_root(const Node& node);
+
     const Node& get_root() const;
 
     Children get_children(const Node& node) const;
 
     Children get_root_children() const { return get_children(get_root()); }
 
+    /** Get the number of nodes in use.
+        Not thread-safe. */
     size_t get_nu_nodes() const;
 
+    size_t get_max_nodes() const { return m_max_nodes; }
+
+    /** Check if a thread storage has nodes freed by prune() that are
+        waiting for the end of the grace period before they can be reused. */
+    bool has_pending(unsigned thread_id) const;
+
     const Node& get_node(NodeIdx i) const;
 
     void set_expanding(const Node& node) { non_const(node).set_expanding(); }
 
+    /** Reset a node that was marked as expanding but could not be expanded
+        because the tree was full. */
+    void set_unexpanded(const Node& node)
+    {
+        non_const(node).unlink_children();
+    }
+
     void link_children(const Node& node, const Node* first_child,
                        unsigned nu_children);
 
+    /** Allow nodes to share children.
+        Not thread-safe. Nodes that share children make prune() and
+        make_root() slower because they need to find the children that are
+        still reachable. The default is false. Not changed by clear(). */
+    void set_allow_shared_children(bool enable)
+    {
+        m_allow_shared_children = enable;
+    }
+
+    bool get_allow_shared_children() const
+    {
+        return m_allow_shared_children;
+    }
+
+    /** Link a node to the existing children of another node.
+        Used for positions that are reached by different move sequences.
+        @pre get_allow_shared_children() */
+    void link_shared_children(const Node& node, NodeIdx first_child,
+                              unsigned nu_children);
+
     void add_value(const Node& node, Float v);
 
     void add_value(const Node& node, Float v, Float weight);
@@ -129,8 +238,25 @@ public:
 
     void inc_visit_count(const Node& node);
 
+    /** Overwrite the value of a node.
+        Only to be used in single-threaded parts of the code. */
+    void set_value(const Node& node, Float value, Float value_count);
+
+    /** Overwrite the visit count of a node.
+        Only to be used in single-threaded parts of the code. */
+    void set_visit_count(const Node& node, Float count);
+
     void swap(Tree& tree);
 
+    /** Let the current thread first-touch the memory of a thread storage.
+        This places the nodes on the NUMA node of the current thread if the
+        operating system uses a first-touch policy and the memory was not
+        used yet. Not thread-safe. */
+    void touch_thread_storage(unsigned thread_id);
+
+    /** The page size of the memory used for the nodes. */
+    size_t get_page_size() const { return m_memory.get_page_size(); }
+
     /** Extract a subtree.
         Note that you still have to re-initialize the value of the subtree
         after the extraction because the value of the root node and the values
@@ -141,8 +267,9 @@ public:
     void extract_subtree(Tree& target, const Node& node) const;
 
     /** Copy a subtree.
-        The caller is responsible that the trees have the same number of
-        maximum nodes and that the target tree has room for the subtree.
+        The children are created in the thread storage with the same index
+        as in the source tree modulo the number of threads of the target tree.
+        Subtrees that do not fit into the target storage are not copied.
         @param target The target tree
         @param target_node The target node
         @param node The root node of the subtree.
@@ -150,7 +277,88 @@ public:
     void copy_subtree(Tree& target, const Node& target_node, const Node& node,
                       Float min_count) const;
 
+    /** Save the tree to a file.
+        The nodes are written with the same binary layout as in memory, so
+        the format depends on the platform and the node type. Unused node
+        memory is not written, which makes the file sparse on file systems
+        that support it. Not thread-safe.
+        @param file
+        @param user_data Additional data to store with the tree.
+        @throws runtime_error */
+    void save(const string& file, const string& user_data) const;
+
+    /** Load a tree saved with save().
+        Replaces the tree including the number of threads and the maximum
+        number of nodes. The nodes are mapped copy-on-write from the file
+        (see libboardgame_base::PageMemory), so they are not read before they
+        are accessed, and later changes of the tree do not modify the file.
+        The file is trusted to contain a valid tree. Not thread-safe.
+        @param file
+        @param[out] user_data The additional data stored with the tree.
+        @throws runtime_error If the file cannot be read or was not written
+        on the same platform with the same node type. */
+    void load(const string& file, string& user_data);
+
+    unsigned get_nu_threads() const { return m_nu_threads; }
+
 private:
+    /** Header of the file format of save() and load().
+        It is followed by the next node index, the number of free blocks and
+        the free blocks (index, size) of each thread storage as 64-bit
+        integers, then by the user data. The nodes start at nodes_offset. */
+    struct FileHeader
+    {
+        char magic[8];
+
+        uint32_t version;
+
+        /** Detects files written on platforms with different byte order. */
+        uint32_t byte_order;
+
+        uint32_t node_size;
+
+        uint32_t move_range;
+
+        uint32_t nu_threads;
+
+        /** See file_flag_shared_children. */
+        uint32_t flags;
+
+        uint64_t max_nodes;
+
+        uint64_t nodes_offset;
+
+        uint64_t user_data_size;
+    };
+
+    static constexpr char file_magic[8] = { 'L', 'B', 'G', 'T', 'R', 'E', 'E',
+                                            '\0' };
+
+    static constexpr uint32_t file_version = 1;
+
+    static constexpr uint32_t file_byte_order = 0x01020304;
+
+    /** Flag in FileHeader::flags for get_allow_shared_children(). */
+    static constexpr uint32_t file_flag_shared_children = 1;
+
+    /** Block of children. */
+    struct Block
+    {
+        Node* begin;
+
+        unsigned size;
+    };
+
+    /** Blocks freed by prune() that cannot be reused before the grace period
+        ended. */
+    struct PendingBlocks
+    {
+        /** Access counters of all threads at the time of the pruning. */
+        vector<uint_least64_t> access_count;
+
+        vector<Block> blocks;
+    };
+
     struct ThreadStorage
     {
         Node* begin;
@@ -158,27 +366,96 @@ private:
         Node* end;
 
         Node* next;
+
+        /** Freed blocks that can be reused, ordered by address.
+            Adjacent blocks are merged. Only accessed by the thread owning
+            the storage. */
+        map<Node*, unsigned> free_by_address;
+
+        /** Same blocks as free_by_address, ordered by size. */
+        multimap<unsigned, Node*> free_by_size;
+
+        size_t nu_free = 0;
+
+        /** Protects pending and nu_pending. */
+        mutex pending_mutex;
+
+        vector<PendingBlocks> pending;
+
+        size_t nu_pending = 0;
+    };
+
+    /** Marks of blocks of children used for freeing nodes if the tree
+        allows shared children. The marks are indexed by the first child of
+        a block. */
+    struct BlockMarks
+    {
+        /** The block is reachable from a node that is not freed. */
+        vector<bool> is_kept;
+
+        /** The block was already visited when freeing nodes. */
+        vector<bool> is_visited;
+
+        explicit BlockMarks(size_t max_nodes)
+            : is_kept(max_nodes),
+              is_visited(max_nodes)
+        { }
+    };
+
+    /** Counter that is odd while a thread accesses the tree.
+        Aligned to avoid false sharing between threads. */
+    struct alignas(64) AccessCount
+    {
+        atomic<uint_least64_t> count{0};
     };
 
 
-    unique_ptr<Node[]> m_nodes;
+    libboardgame_base::PageMemory m_memory;
+
+    Node* m_nodes;
 
     unique_ptr<ThreadStorage[]> m_thread_storage;
 
+    unique_ptr<AccessCount[]> m_access_count;
+
     unsigned m_nu_threads;
 
     size_t m_max_nodes;
 
     size_t m_nodes_per_thread;
 
+    bool m_allow_shared_children = false;
+
+
+    void add_free_block(ThreadStorage& thread_storage, Node* begin,
+                        unsigned size);
+
+    void erase_free_block(ThreadStorage& thread_storage, Node* begin,
+                          unsigned size);
 
     bool contains(const Node& node) const;
 
-    void copy_recurse(Tree& target, const Node& target_node, const Node& node,
-                      Float min_count) const;
+    void free_recurse(const Node& first_child, unsigned nu_children,
+                      vector<vector<Block>>& blocks, size_t& nu_freed,
+                      BlockMarks* marks) const;
+
+    void get_blocks(const Node& node, vector<vector<Block>>& blocks,
+                    BlockMarks* marks) const;
+
+    bool get_free_block(ThreadStorage& thread_storage, unsigned size,
+                        Node*& begin, Node*& end);
 
     unsigned get_thread_storage(const Node& node) const;
 
+    void mark_kept(const Node& node, Float min_count,
+                   BlockMarks& marks) const;
+
+    void prune_recurse(const Node& node, Float min_count,
+                       vector<vector<Block>>& blocks, size_t& nu_freed,
+                       BlockMarks* marks);
+
+    void reclaim_pending(ThreadStorage& thread_storage, bool force);
+
     Node& non_const(const Node& node) const;
 };
 
@@ -186,8 +463,11 @@ template<typename N>
 inline Tree<N>::NodeExpander::NodeExpander(
         unsigned thread_id, Tree& tree, [[maybe_unused]] Float child_min_count,
         [[maybe_unused]] Float max_move_prior)
-    : m_thread_storage(tree.m_thread_storage[thread_id]),
+    : m_tree(tree),
+      m_thread_storage(tree.m_thread_storage[thread_id]),
       m_first_child(m_thread_storage.next),
+      m_next(m_thread_storage.next),
+      m_end(m_thread_storage.end),
       m_best_child(nullptr)
 {
     LIBBOARDGAME_ASSERT(thread_id < tree.m_nu_threads);
@@ -205,22 +485,34 @@ inline void Tree<N>::NodeExpander::add_child(const Move& mv, Float value,
     LIBBOARDGAME_ASSERT(value > -numeric_limits<Float>::max());
     LIBBOARDGAME_ASSERT(count >= m_child_min_count);
     LIBBOARDGAME_ASSERT(move_prior <= m_max_move_prior);
-    auto& next = m_thread_storage.next;
-    LIBBOARDGAME_ASSERT(next < m_thread_storage.end);
-    next->init(mv, value, count, move_prior);
+    LIBBOARDGAME_ASSERT(m_next < m_end);
+    m_next->init(mv, value, count, move_prior);
     if (move_prior > m_best_move_prior)
     {
-        m_best_child = next;
+        m_best_child = m_next;
         m_best_move_prior = move_prior;
     }
-    ++next;
+    ++m_next;
 }
 
 template<typename N>
-inline bool Tree<N>::NodeExpander::check_capacity(
-        unsigned short nu_children) const
+inline bool Tree<N>::NodeExpander::check_capacity(unsigned short nu_children)
 {
-    return m_thread_storage.end - m_thread_storage.next  >= nu_children;
+    LIBBOARDGAME_ASSERT(m_next == m_first_child);
+    if (m_end - m_next >= nu_children)
+        return true;
+    if (! m_tree.get_free_block(m_thread_storage, nu_children, m_first_child,
+                                m_end))
+    {
+        // Reclaiming freed blocks can have increased the unused memory
+        m_first_child = m_thread_storage.next;
+        m_next = m_first_child;
+        m_end = m_thread_storage.end;
+        return m_end - m_next >= nu_children;
+    }
+    m_next = m_first_child;
+    m_is_free_block = true;
+    return true;
 }
 
 template<typename N>
@@ -250,14 +542,18 @@ inline auto Tree<N>::get_node(NodeIdx i) const -> const Node&
 template<typename N>
 inline void Tree<N>::NodeExpander::link_children(Tree& tree, const Node& node)
 {
-    auto nu_children =
-            static_cast<unsigned>(m_thread_storage.next - m_first_child);
+    auto nu_children = static_cast<unsigned>(m_next - m_first_child);
+    if (m_is_free_block)
+        tree.add_free_block(m_thread_storage, m_next,
+                            static_cast<unsigned>(m_end - m_next));
+    else
+        m_thread_storage.next = m_next;
     tree.link_children(node, m_first_child, nu_children);
 }
 
 
 template<typename N>
-Tree<N>::Tree(size_t memory, unsigned nu_threads)
+Tree<N>::Tree(size_t memory, unsigned nu_threads, bool huge_pages)
 {
     if (nu_threads == 0)
         nu_threads = 1;
@@ -271,18 +567,20 @@ Tree<N>::Tree(size_t memory, unsigned nu_threads)
     m_nu_threads = nu_threads;
     m_max_nodes = max_nodes;
 
-    // Using make_unique<Node[]>(max_nodes) slows down the array creation and
-    // thereby the startup time of Pentobi with GCC 7/8 because the compiler
-    // does not optimize away the call to the empty Move() constructor (last
-    // tested with GCC 7.2.0 and GCC 8.0.0 on Ubuntu 17.10).
-    m_nodes.reset(new Node[max_nodes]);
+    // Default-initialize the nodes, value-initializing them would write to
+    // all pages of the memory and slow down the startup time of Pentobi.
+    m_memory = libboardgame_base::PageMemory(max_nodes * sizeof(Node),
+                                             huge_pages);
+    m_nodes = static_cast<Node*>(m_memory.get());
+    uninitialized_default_construct_n(m_nodes, max_nodes);
 
     m_thread_storage = make_unique<ThreadStorage[]>(nu_threads);
+    m_access_count = make_unique<AccessCount[]>(nu_threads);
     m_nodes_per_thread = max_nodes / nu_threads;
     for (unsigned i = 0; i < nu_threads; ++i)
     {
         auto& thread_storage = m_thread_storage[i];
-        thread_storage.begin = m_nodes.get() + i * m_nodes_per_thread;
+        thread_storage.begin = m_nodes + i * m_nodes_per_thread;
         thread_storage.end = thread_storage.begin + m_nodes_per_thread;
     }
     clear();
@@ -300,67 +598,129 @@ inline void Tree<N>::add_value(const Node& node, Float v, Float weight)
     non_const(node).add_value(v, weight);
 }
 
+/** Add a block to the free blocks of a storage.
+    The block is merged with adjacent free blocks and returned to the unused
+    memory of the storage if it is at its end. Only to be used by the thread
+    owning the storage. */
+template<typename N>
+void Tree<N>::add_free_block(ThreadStorage& thread_storage, Node* begin,
+                             unsigned size)
+{
+    if (size == 0)
+        return;
+    auto& free_by_address = thread_storage.free_by_address;
+    auto next = free_by_address.lower_bound(begin);
+    if (next != free_by_address.end() && begin + size == next->first)
+    {
+        auto next_size = next->second;
+        erase_free_block(thread_storage, next->first, next_size);
+        size += next_size;
+    }
+    next = free_by_address.lower_bound(begin);
+    if (next != free_by_address.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == begin)
+        {
+            auto prev_begin = prev->first;
+            auto prev_size = prev->second;
+            erase_free_block(thread_storage, prev_begin, prev_size);
+            begin = prev_begin;
+            size += prev_size;
+        }
+    }
+    if (begin + size == thread_storage.next)
+    {
+        thread_storage.next = begin;
+        return;
+    }
+    free_by_address.emplace(begin, size);
+    thread_storage.free_by_size.emplace(size, begin);
+    thread_storage.nu_free += size;
+}
+
+template<typename N>
+inline void Tree<N>::begin_access(unsigned thread_id)
+{
+    // Sequentially consistent, such that prune() either sees the odd count
+    // or this thread sees the children unlinked by prune()
+    m_access_count[thread_id].count.fetch_add(1, memory_order_seq_cst);
+}
+
 template<typename N>
 void Tree<N>::clear()
 {
     m_thread_storage[0].next = m_thread_storage[0].begin + 1;
     for (unsigned i = 1; i < m_nu_threads; ++i)
         m_thread_storage[i].next = m_thread_storage[i].begin;
+    for (unsigned i = 0; i < m_nu_threads; ++i)
+    {
+        auto& thread_storage = m_thread_storage[i];
+        thread_storage.free_by_address.clear();
+        thread_storage.free_by_size.clear();
+        thread_storage.nu_free = 0;
+        thread_storage.pending.clear();
+        thread_storage.nu_pending = 0;
+    }
     m_nodes[0].init_root();
 }
 
 template<typename N>
 bool Tree<N>::contains(const Node& node) const
 {
-    return &node >= m_nodes.get() && &node < m_nodes.get() + m_max_nodes;
+    return &node >= m_nodes && &node < m_nodes + m_max_nodes;
 }
 
 template<typename N>
 void Tree<N>::copy_subtree(Tree& target, const Node& target_node,
                            const Node& node, Float min_count) const
 {
-    target.non_const(target_node).copy_data_from(node);
-    if (node.get_nu_children() > 0)
-        copy_recurse(target, target_node, node, min_count);
-    else
-        target.non_const(target_node).unlink_children_st();
-}
-
-template<typename N>
-void Tree<N>::copy_recurse(Tree& target, const Node& target_node,
-                           const Node& node, Float min_count) const
-{
-    LIBBOARDGAME_ASSERT(target.m_max_nodes == m_max_nodes);
-    LIBBOARDGAME_ASSERT(target.m_nu_threads == m_nu_threads);
     LIBBOARDGAME_ASSERT(contains(node));
-    LIBBOARDGAME_ASSERT(node.get_nu_children() > 0);
-    auto nu_children = static_cast<unsigned>(node.get_nu_children());
-    auto& first_child = get_node(node.get_first_child());
-    // Create target children in the equivalent thread storage as in source.
-    // This ensures that the thread storage will not overflow (because the
-    // trees have identical nu_threads/max_nodes)
-    ThreadStorage& thread_storage =
-        target.m_thread_storage[get_thread_storage(first_child)];
-    auto target_child = thread_storage.next;
-    auto target_first_child =
-        static_cast<NodeIdx>(target_child - target.m_nodes.get());
-    target.non_const(target_node).link_children_st(target_first_child,
-                                                   nu_children);
-    thread_storage.next += nu_children;
-    LIBBOARDGAME_ASSERT(thread_storage.next < thread_storage.end);
-    auto end = &first_child + nu_children;
-    for (auto i = &first_child; i != end; ++i, ++target_child)
+    target.non_const(target_node).copy_data_from(node);
+    target.non_const(target_node).unlink_children_st();
+    // Copy breadth-first, such that the upper levels of the subtree are kept
+    // if the target tree is too small
+    vector<pair<const Node*, const Node*>> queue;
+    queue.emplace_back(&target_node, &node);
+    for (size_t i = 0; i < queue.size(); ++i)
     {
-        target_child->copy_data_from(*i);
-        if (i->get_nu_children() <= 0 || i->get_visit_count() < min_count)
+        auto& target_parent = *queue[i].first;
+        auto& parent = *queue[i].second;
+        if (parent.get_nu_children() <= 0)
+            continue;
+        auto nu_children = static_cast<unsigned>(parent.get_nu_children());
+        auto& first_child = get_node(parent.get_first_child());
+        // Create target children in the equivalent thread storage as in
+        // source. This ensures that the thread storage will not overflow if
+        // the trees have identical nu_threads/max_nodes.
+        ThreadStorage& thread_storage =
+            target.m_thread_storage[get_thread_storage(first_child)
+                                    % target.m_nu_threads];
+        auto target_child = thread_storage.next;
+        if (thread_storage.end - target_child < nu_children)
+            continue;
+        auto target_first_child =
+            static_cast<NodeIdx>(target_child - target.m_nodes);
+        target.non_const(target_parent).link_children_st(target_first_child,
+                                                         nu_children);
+        thread_storage.next += nu_children;
+        auto end = &first_child + nu_children;
+        for (auto j = &first_child; j != end; ++j, ++target_child)
         {
+            target_child->copy_data_from(*j);
             target_child->unlink_children_st();
-            continue;
+            if (j->get_nu_children() > 0 && j->get_visit_count() >= min_count)
+                queue.emplace_back(target_child, j);
         }
-        copy_recurse(target, *target_child, *i, min_count);
     }
 }
 
+template<typename N>
+inline void Tree<N>::end_access(unsigned thread_id)
+{
+    m_access_count[thread_id].count.fetch_add(1, memory_order_release);
+}
+
 template<typename N>
 void Tree<N>::extract_subtree(Tree& target, const Node& node) const
 {
@@ -371,6 +731,110 @@ void Tree<N>::extract_subtree(Tree& target, const Node& node) const
     copy_subtree(target, target.m_nodes[0], node, 0);
 }
 
+/** Add a subtree to the blocks to free.
+    @param first_child
+    @param nu_children
+    @param blocks
+    @param nu_freed
+    @param marks Marks for skipping blocks that are still reachable or were
+    already freed if the tree allows shared children, otherwise null. */
+template<typename N>
+void Tree<N>::free_recurse(const Node& first_child, unsigned nu_children,
+                           vector<vector<Block>>& blocks, size_t& nu_freed,
+                           BlockMarks* marks) const
+{
+    if (marks != nullptr)
+    {
+        size_t i = &first_child - m_nodes;
+        if (marks->is_kept[i] || marks->is_visited[i])
+            return;
+        marks->is_visited[i] = true;
+    }
+    blocks[get_thread_storage(first_child)].push_back(
+                {&non_const(first_child), nu_children});
+    nu_freed += nu_children;
+    auto end = &first_child + nu_children;
+    for (auto i = &first_child; i != end; ++i)
+    {
+        auto nu_grandchildren = i->get_nu_children();
+        if (nu_grandchildren > 0)
+            free_recurse(get_node(i->get_first_child()),
+                         static_cast<unsigned>(nu_grandchildren), blocks,
+                         nu_freed, marks);
+    }
+}
+
+template<typename N>
+bool Tree<N>::has_pending(unsigned thread_id) const
+{
+    auto& thread_storage = m_thread_storage[thread_id];
+    lock_guard lock(thread_storage.pending_mutex);
+    return ! thread_storage.pending.empty();
+}
+
+template<typename N>
+void Tree<N>::erase_free_block(ThreadStorage& thread_storage, Node* begin,
+                               unsigned size)
+{
+    thread_storage.free_by_address.erase(begin);
+    auto range = thread_storage.free_by_size.equal_range(size);
+    for (auto i = range.first; i != range.second; ++i)
+        if (i->second == begin)
+        {
+            thread_storage.free_by_size.erase(i);
+            break;
+        }
+    thread_storage.nu_free -= size;
+}
+
+/** Get the blocks of children in the subtree of a node.
+    @param node
+    @param[out] blocks The blocks for each thread storage
+    @param marks Used for visiting shared children only once if the tree
+    allows shared children, otherwise null. */
+template<typename N>
+void Tree<N>::get_blocks(const Node& node, vector<vector<Block>>& blocks,
+                         BlockMarks* marks) const
+{
+    auto nu_children = node.get_nu_children();
+    if (nu_children <= 0)
+        return;
+    auto i = node.get_first_child();
+    if (marks != nullptr)
+    {
+        if (marks->is_visited[i])
+            return;
+        marks->is_visited[i] = true;
+    }
+    auto& first_child = get_node(i);
+    blocks[get_thread_storage(first_child)].push_back(
+                {&non_const(first_child), static_cast<unsigned>(nu_children)});
+    auto end = &first_child + nu_children;
+    for (auto j = &first_child; j != end; ++j)
+        get_blocks(*j, blocks, marks);
+}
+
+/** Get a freed block of at least a given size.
+    Only to be used by the thread owning the storage. */
+template<typename N>
+bool Tree<N>::get_free_block(ThreadStorage& thread_storage, unsigned size,
+                             Node*& begin, Node*& end)
+{
+    auto& free_by_size = thread_storage.free_by_size;
+    auto i = free_by_size.lower_bound(size);
+    if (i == free_by_size.end())
+    {
+        reclaim_pending(thread_storage, false);
+        i = free_by_size.lower_bound(size);
+        if (i == free_by_size.end())
+            return false;
+    }
+    begin = i->second;
+    end = begin + i->first;
+    erase_free_block(thread_storage, begin, i->first);
+    return true;
+}
+
 template<typename N>
 size_t Tree<N>::get_nu_nodes() const
 {
@@ -379,6 +843,7 @@ size_t Tree<N>::get_nu_nodes() const
     {
         auto& thread_storage = m_thread_storage[i];
         result += thread_storage.next - thread_storage.begin;
+        result -= thread_storage.nu_free + thread_storage.nu_pending;
     }
     return result;
 }
@@ -393,7 +858,7 @@ inline auto Tree<N>::get_root() const -> const Node&
 template<typename N>
 inline unsigned Tree<N>::get_thread_storage(const Node& node) const
 {
-    size_t diff = &node - m_nodes.get();
+    size_t diff = &node - m_nodes;
     return static_cast<unsigned>(diff / m_nodes_per_thread);
 }
 
@@ -407,12 +872,188 @@ template<typename N>
 inline void Tree<N>::link_children(const Node& node, const Node* first_child,
                                    unsigned nu_children)
 {
-    auto first_child_idx = static_cast<NodeIdx>(first_child - m_nodes.get());
+    auto first_child_idx = static_cast<NodeIdx>(first_child - m_nodes);
     LIBBOARDGAME_ASSERT(first_child_idx > 0);
     LIBBOARDGAME_ASSERT(first_child_idx < m_max_nodes);
     non_const(node).link_children(first_child_idx, nu_children);
 }
 
+template<typename N>
+inline void Tree<N>::link_shared_children(const Node& node,
+                                          NodeIdx first_child,
+                                          unsigned nu_children)
+{
+    LIBBOARDGAME_ASSERT(m_allow_shared_children);
+    LIBBOARDGAME_ASSERT(first_child > 0);
+    LIBBOARDGAME_ASSERT(first_child < m_max_nodes);
+    non_const(node).link_children(first_child, nu_children);
+}
+
+template<typename N>
+void Tree<N>::load(const string& file, string& user_data)
+{
+    ifstream in(file, ios::binary);
+    if (! in)
+        throw runtime_error("could not open " + file);
+    FileHeader header;
+    if (! in.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || memcmp(header.magic, file_magic, sizeof(file_magic)) != 0)
+        throw runtime_error("not a search tree file: " + file);
+    if (header.version != file_version
+            || header.byte_order != file_byte_order
+            || header.node_size != sizeof(Node)
+            || header.move_range != Move::range)
+        throw runtime_error("incompatible search tree file: " + file);
+    auto nu_threads = header.nu_threads;
+    auto max_nodes = header.max_nodes;
+    if (nu_threads == 0 || max_nodes < nu_threads
+            || max_nodes > numeric_limits<NodeIdx>::max())
+        throw runtime_error("invalid search tree file: " + file);
+    // All sizes are checked against the file size before they are used, so
+    // that a corrupt file cannot cause large allocations
+    in.seekg(0, ios::end);
+    auto file_size = static_cast<uint64_t>(in.tellg());
+    in.seekg(sizeof(header));
+    auto nodes_offset = header.nodes_offset;
+    if (! in || nodes_offset < sizeof(header) || nodes_offset > file_size
+            || max_nodes * sizeof(Node) > file_size - nodes_offset)
+        throw runtime_error("invalid search tree file: " + file);
+    // Remaining bytes before the nodes
+    auto remaining = nodes_offset - sizeof(header);
+    auto read_int = [&] {
+        uint64_t i = 0;
+        in.read(reinterpret_cast<char*>(&i), sizeof(i));
+        return i;
+    };
+    if (nu_threads > remaining / (2 * sizeof(uint64_t)))
+        throw runtime_error("invalid search tree file: " + file);
+    auto nodes_per_thread = max_nodes / nu_threads;
+    vector<uint64_t> next(nu_threads);
+    vector<vector<pair<uint64_t, unsigned>>> blocks(nu_threads);
+    for (unsigned i = 0; i < nu_threads; ++i)
+    {
+        auto begin = i * nodes_per_thread;
+        next[i] = read_int();
+        auto nu_blocks = read_int();
+        if (! in || next[i] < begin || next[i] > begin + nodes_per_thread
+                || remaining < 2 * sizeof(uint64_t))
+            throw runtime_error("invalid search tree file: " + file);
+        remaining -= 2 * sizeof(uint64_t);
+        if (nu_blocks > nodes_per_thread
+                || nu_blocks > remaining / (2 * sizeof(uint64_t)))
+            throw runtime_error("invalid search tree file: " + file);
+        remaining -= nu_blocks * 2 * sizeof(uint64_t);
+        for (uint64_t j = 0; j < nu_blocks; ++j)
+        {
+            auto block_begin = read_int();
+            auto block_size = read_int();
+            if (! in || block_begin < begin || block_size > next[i]
+                    || block_begin > next[i] - block_size)
+                throw runtime_error("invalid search tree file: " + file);
+            blocks[i].emplace_back(block_begin,
+                                   static_cast<unsigned>(block_size));
+        }
+    }
+    if (header.user_data_size > remaining)
+        throw runtime_error("invalid search tree file: " + file);
+    user_data.resize(header.user_data_size);
+    in.read(&user_data[0], static_cast<streamsize>(user_data.size()));
+    if (! in)
+        throw runtime_error("invalid search tree file: " + file);
+    in.close();
+
+    libboardgame_base::PageMemory memory(file, nodes_offset,
+                                         max_nodes * sizeof(Node));
+    m_memory = move(memory);
+    m_nodes = static_cast<Node*>(m_memory.get());
+    m_nu_threads = nu_threads;
+    m_max_nodes = max_nodes;
+    m_nodes_per_thread = nodes_per_thread;
+    m_allow_shared_children =
+            ((header.flags & file_flag_shared_children) != 0);
+    m_thread_storage = make_unique<ThreadStorage[]>(nu_threads);
+    m_access_count = make_unique<AccessCount[]>(nu_threads);
+    for (unsigned i = 0; i < nu_threads; ++i)
+    {
+        auto& thread_storage = m_thread_storage[i];
+        thread_storage.begin = m_nodes + i * m_nodes_per_thread;
+        thread_storage.end = thread_storage.begin + m_nodes_per_thread;
+        thread_storage.next = m_nodes + next[i];
+        for (auto& block : blocks[i])
+            add_free_block(thread_storage, m_nodes + block.first,
+                           block.second);
+    }
+}
+
+template<typename N>
+void Tree<N>::make_root(const Node& node)
+{
+    LIBBOARDGAME_ASSERT(contains(node));
+    auto& root = m_nodes[0];
+    if (&node == &root)
+        return;
+    vector<vector<Block>> blocks(m_nu_threads);
+    unique_ptr<BlockMarks> marks;
+    if (m_allow_shared_children)
+        marks = make_unique<BlockMarks>(m_max_nodes);
+    get_blocks(node, blocks, marks.get());
+    root.copy_data_from(node);
+    auto nu_node_children = node.get_nu_children();
+    if (nu_node_children > 0)
+        root.link_children_st(node.get_first_child(),
+                              static_cast<unsigned>(nu_node_children));
+    else
+        root.unlink_children_st();
+    // Rebuild the free blocks from the blocks reachable from the new root,
+    // such that blocks lost during a prune() are reused again
+    for (unsigned i = 0; i < m_nu_threads; ++i)
+    {
+        auto& thread_storage = m_thread_storage[i];
+        thread_storage.free_by_address.clear();
+        thread_storage.free_by_size.clear();
+        thread_storage.nu_free = 0;
+        thread_storage.pending.clear();
+        thread_storage.nu_pending = 0;
+        auto& thread_blocks = blocks[i];
+        sort(thread_blocks.begin(), thread_blocks.end(),
+             [](const Block& b1, const Block& b2) {
+                 return b1.begin < b2.begin;
+             });
+        // The gaps between the kept blocks are free
+        vector<Block> free_blocks;
+        auto pos = thread_storage.begin + (i == 0 ? 1 : 0);
+        for (auto& block : thread_blocks)
+        {
+            if (block.begin > pos)
+                free_blocks.push_back(
+                            {pos, static_cast<unsigned>(block.begin - pos)});
+            pos = max(pos, block.begin + block.size);
+        }
+        thread_storage.next = pos;
+        for (auto& block : free_blocks)
+            add_free_block(thread_storage, block.begin, block.size);
+    }
+}
+
+/** Mark the blocks of children reachable from a node that will not be
+    freed. */
+template<typename N>
+void Tree<N>::mark_kept(const Node& node, Float min_count,
+                        BlockMarks& marks) const
+{
+    auto nu_children = node.get_nu_children();
+    if (nu_children <= 0 || node.get_visit_count() < min_count)
+        return;
+    auto i = node.get_first_child();
+    if (marks.is_kept[i])
+        return;
+    marks.is_kept[i] = true;
+    auto& first_child = get_node(i);
+    auto end = &first_child + nu_children;
+    for (auto j = &first_child; j != end; ++j)
+        mark_kept(*j, min_count, marks);
+}
+
 /** Convert a const reference to node from user to a non-const reference.
     The user has only read access to the nodes, because the tree guarantees
     the validity of the tree structure. */
@@ -429,6 +1070,220 @@ inline void Tree<N>::add_value_remove_loss(const Node& node, Float v)
     non_const(node).add_value_remove_loss(v);
 }
 
+template<typename N>
+inline void Tree<N>::set_value(const Node& node, Float value,
+                               Float value_count)
+{
+    non_const(node).set_value_st(value, value_count);
+}
+
+template<typename N>
+inline void Tree<N>::set_visit_count(const Node& node, Float count)
+{
+    non_const(node).set_visit_count_st(count);
+}
+
+template<typename N>
+void Tree<N>::touch_thread_storage(unsigned thread_id)
+{
+    auto& thread_storage = m_thread_storage[thread_id];
+    libboardgame_base::touch_memory(
+                thread_storage.begin,
+                (thread_storage.end - thread_storage.begin) * sizeof(Node));
+}
+
+template<typename N>
+size_t Tree<N>::prune(Float min_count)
+{
+    return prune(min_count, nullptr);
+}
+
+template<typename N>
+size_t Tree<N>::prune(Float min_count, const function<void()>& after_mark)
+{
+    vector<vector<Block>> blocks(m_nu_threads);
+    size_t nu_freed = 0;
+    unique_ptr<BlockMarks> marks;
+    if (m_allow_shared_children)
+    {
+        marks = make_unique<BlockMarks>(m_max_nodes);
+        auto& root = get_root();
+        if (root.get_nu_children() > 0)
+            marks->is_kept[root.get_first_child()] = true;
+        for (auto& i : get_root_children())
+            mark_kept(i, min_count, *marks);
+    }
+    if (after_mark)
+        after_mark();
+    for (auto& i : get_root_children())
+        prune_recurse(i, min_count, blocks, nu_freed, marks.get());
+    // Threads that did not access the tree or started a new access after
+    // this fence cannot see the unlinked children anymore
+    atomic_thread_fence(memory_order_seq_cst);
+    vector<uint_least64_t> access_count(m_nu_threads);
+    for (unsigned i = 0; i < m_nu_threads; ++i)
+        access_count[i] = m_access_count[i].count.load(memory_order_relaxed);
+    for (unsigned i = 0; i < m_nu_threads; ++i)
+    {
+        if (blocks[i].empty())
+            continue;
+        auto& thread_storage = m_thread_storage[i];
+        size_t nu_pending = 0;
+        for (auto& block : blocks[i])
+            nu_pending += block.size;
+        lock_guard lock(thread_storage.pending_mutex);
+        thread_storage.pending.push_back({access_count, move(blocks[i])});
+        thread_storage.nu_pending += nu_pending;
+    }
+    return nu_freed;
+}
+
+template<typename N>
+void Tree<N>::prune_recurse(const Node& node, Float min_count,
+                            vector<vector<Block>>& blocks, size_t& nu_freed,
+                            BlockMarks* marks)
+{
+    auto nu_children = node.get_nu_children();
+    if (nu_children <= 0)
+        return;
+    auto& first_child = get_node(node.get_first_child());
+    // With shared children, a node must also be unlinked if its children
+    // were not marked as kept, because other threads can increase the visit
+    // count after the marking. Otherwise, a node that reached the minimum
+    // count after the marking could keep the link to a freed block.
+    if (node.get_visit_count() < min_count
+            || (marks != nullptr && ! marks->is_kept[node.get_first_child()]))
+    {
+        non_const(node).unlink_children();
+        free_recurse(first_child, static_cast<unsigned>(nu_children), blocks,
+                     nu_freed, marks);
+        return;
+    }
+    if (marks != nullptr)
+    {
+        auto i = node.get_first_child();
+        if (marks->is_visited[i])
+            return;
+        marks->is_visited[i] = true;
+    }
+    auto end = &first_child + nu_children;
+    for (auto i = &first_child; i != end; ++i)
+        prune_recurse(*i, min_count, blocks, nu_freed, marks);
+}
+
+/** Move pending blocks, for which the grace period ended, to the free
+    blocks.
+    Only to be used by the thread owning the storage.
+    @param thread_storage
+    @param force Move all pending blocks. Can be used if no other thread
+    accesses the tree. */
+template<typename N>
+void Tree<N>::reclaim_pending(ThreadStorage& thread_storage, bool force)
+{
+    lock_guard lock(thread_storage.pending_mutex);
+    auto& pending = thread_storage.pending;
+    for (auto i = pending.begin(); i != pending.end(); )
+    {
+        bool can_reclaim = true;
+        if (! force)
+            for (unsigned j = 0; j < m_nu_threads; ++j)
+            {
+                auto count = i->access_count[j];
+                // Access count is odd if the thread was accessing the tree
+                if ((count & 1) != 0
+                        && m_access_count[j].count.load(memory_order_acquire)
+                            == count)
+                {
+                    can_reclaim = false;
+                    break;
+                }
+            }
+        if (! can_reclaim)
+        {
+            ++i;
+            continue;
+        }
+        for (auto& block : i->blocks)
+        {
+            add_free_block(thread_storage, block.begin, block.size);
+            thread_storage.nu_pending -= block.size;
+        }
+        i = pending.erase(i);
+    }
+}
+
+template<typename N>
+void Tree<N>::save(const string& file, const string& user_data) const
+{
+    vector<vector<uint64_t>> storage_data(m_nu_threads);
+    size_t size = sizeof(FileHeader);
+    for (unsigned i = 0; i < m_nu_threads; ++i)
+    {
+        auto& thread_storage = m_thread_storage[i];
+        auto& data = storage_data[i];
+        data.push_back(static_cast<uint64_t>(thread_storage.next - m_nodes));
+        data.push_back(0);
+        auto add_block = [&](const Node* begin, unsigned nu_nodes) {
+            data.push_back(static_cast<uint64_t>(begin - m_nodes));
+            data.push_back(nu_nodes);
+        };
+        for (auto& j : thread_storage.free_by_address)
+            add_block(j.first, j.second);
+        {
+            lock_guard lock(thread_storage.pending_mutex);
+            for (auto& j : thread_storage.pending)
+                for (auto& block : j.blocks)
+                    add_block(block.begin, block.size);
+        }
+        data[1] = (data.size() - 2) / 2;
+        size += data.size() * sizeof(uint64_t);
+    }
+    size += user_data.size();
+    auto alignment = libboardgame_base::PageMemory::file_alignment;
+    FileHeader header;
+    memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version = file_version;
+    header.byte_order = file_byte_order;
+    header.node_size = sizeof(Node);
+    header.move_range = Move::range;
+    header.nu_threads = m_nu_threads;
+    header.flags = (m_allow_shared_children ? file_flag_shared_children : 0);
+    header.max_nodes = m_max_nodes;
+    header.nodes_offset = (size + alignment - 1) / alignment * alignment;
+    header.user_data_size = user_data.size();
+    ofstream out(file, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (auto& data : storage_data)
+        out.write(reinterpret_cast<const char*>(data.data()),
+                  static_cast<streamsize>(data.size() * sizeof(uint64_t)));
+    out.write(user_data.data(), static_cast<streamsize>(user_data.size()));
+    auto end = header.nodes_offset + m_max_nodes * sizeof(Node);
+    uint64_t pos = 0;
+    for (unsigned i = 0; i < m_nu_threads; ++i)
+    {
+        auto& thread_storage = m_thread_storage[i];
+        if (thread_storage.next == thread_storage.begin)
+            continue;
+        out.seekp(static_cast<streamoff>(
+                      header.nodes_offset
+                      + (thread_storage.begin - m_nodes) * sizeof(Node)));
+        auto nu_bytes = (thread_storage.next - thread_storage.begin)
+                * sizeof(Node);
+        out.write(reinterpret_cast<const char*>(thread_storage.begin),
+                  static_cast<streamsize>(nu_bytes));
+        pos = static_cast<uint64_t>(out.tellp());
+    }
+    // The file must contain the whole node memory for mapping it in load()
+    if (pos < end)
+    {
+        out.seekp(static_cast<streamoff>(end - 1));
+        out.put('\0');
+    }
+    out.close();
+    if (! out)
+        throw runtime_error("could not write " + file);
+}
+
 template<typename N>
 void Tree<N>::swap(Tree& tree)
 {
@@ -438,15 +1293,21 @@ void Tree<N>::swap(Tree& tree)
         unsigned m_nu_threads;
         size_t m_max_nodes;
         size_t m_nodes_per_thread;
+        bool m_allow_shared_children;
+        libboardgame_base::PageMemory m_memory;
+        Node* m_nodes;
         unique_ptr<ThreadStorage> m_thread_storage;
-        unique_ptr<Node[]> m_nodes;
+        unique_ptr<AccessCount> m_access_count;
     };
     static_assert(sizeof(Tree) == sizeof(Dummy));
     std::swap(m_nu_threads, tree.m_nu_threads);
     std::swap(m_max_nodes, tree.m_max_nodes);
     std::swap(m_nodes_per_thread, tree.m_nodes_per_thread);
+    std::swap(m_allow_shared_children, tree.m_allow_shared_children);
     m_thread_storage.swap(tree.m_thread_storage);
-    m_nodes.swap(tree.m_nodes);
+    m_access_count.swap(tree.m_access_count);
+    std::swap(m_memory, tree.m_memory);
+    std::swap(m_nodes, tree.m_nodes);
 }
 
 //-----------------------------------------------------------------------------
@@ -34,4 +34,26 @@ LIBBOARDGAME_TEST_CASE(libboardgame_mcts_node_add_value_remove_loss)
     LIBBOARDGAME_CHECK_CLOSE(node.get_value(), 3.5f, 1e-4f);
 }
 
+/** Test the reduced precision of the move prior and the visit count in the
+    compact node layout. */
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_node_compact)
+{
+    using Node = libboardgame_mcts::Node<unsigned short, float, true, true>;
+    static_assert(sizeof(Node) == 20);
+    Node node;
+    for (float prior : { 1.f, 0.5f, 0.3f, 0.01f, 1e-5f })
+    {
+        node.init(0, 0.5, 0, prior);
+        LIBBOARDGAME_CHECK_CLOSE(node.get_move_prior(), prior, 7.f);
+    }
+    node.init(0, 0.5, 0, 0.3f);
+    node.inc_visit_count();
+    node.inc_visit_count();
+    LIBBOARDGAME_CHECK_EQUAL(node.get_visit_count(), 2.f);
+    node.set_visit_count_st(16777215);
+    node.inc_visit_count();
+    LIBBOARDGAME_CHECK_EQUAL(node.get_visit_count(), 16777215.f);
+    LIBBOARDGAME_CHECK_CLOSE(node.get_move_prior(), 0.3f, 7.f);
+}
+
 //-----------------------------------------------------------------------------
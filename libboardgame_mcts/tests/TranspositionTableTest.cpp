@@ -0,0 +1,55 @@
+//-----------------------------------------------------------------------------
+/** @file libboardgame_mcts/tests/TranspositionTableTest.cpp
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include "libboardgame_mcts/TranspositionTable.h"
+
+#include "libboardgame_test/Test.h"
+
+using namespace std;
+using libboardgame_mcts::NodeIdx;
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+using TranspositionTable = libboardgame_mcts::TranspositionTable<true>;
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_transposition_table_store)
+{
+    TranspositionTable tt(16);
+    NodeIdx first_child;
+    unsigned nu_children;
+    uint_least32_t generation;
+    tt.store(123, 5, 3, tt.get_generation());
+    LIBBOARDGAME_CHECK(tt.lookup(123, first_child, nu_children, generation));
+    LIBBOARDGAME_CHECK_EQUAL(first_child, NodeIdx(5));
+    LIBBOARDGAME_CHECK_EQUAL(nu_children, 3u);
+    LIBBOARDGAME_CHECK_EQUAL(generation, tt.get_generation());
+    tt.invalidate();
+    LIBBOARDGAME_CHECK(! tt.lookup(123, first_child, nu_children, generation));
+}
+
+/** Test that children linked before an invalidation are not stored. */
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_transposition_table_store_old)
+{
+    TranspositionTable tt(16);
+    NodeIdx first_child;
+    unsigned nu_children;
+    uint_least32_t generation;
+    auto old_generation = tt.get_generation();
+    tt.begin_invalidate();
+    tt.store(123, 5, 3, old_generation);
+    tt.store(123, 5, 3, tt.get_generation());
+    tt.end_invalidate();
+    tt.store(123, 5, 3, old_generation);
+    LIBBOARDGAME_CHECK(! tt.lookup(123, first_child, nu_children, generation));
+}
+
+//-----------------------------------------------------------------------------
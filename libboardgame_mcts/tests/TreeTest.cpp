@@ -0,0 +1,244 @@
+//-----------------------------------------------------------------------------
+/** @file libboardgame_mcts/tests/TreeTest.cpp
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include "libboardgame_mcts/Tree.h"
+
+#include <cstdio>
+#include <fstream>
+#include "libboardgame_test/Test.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+struct Move
+{
+    static constexpr unsigned range = 100;
+
+    unsigned i;
+
+    static Move null() { return {range}; }
+};
+
+using Node = libboardgame_mcts::Node<Move, float, true>;
+
+using Tree = libboardgame_mcts::Tree<Node>;
+
+bool expand(Tree& tree, const Node& node, unsigned nu_children)
+{
+    Tree::NodeExpander expander(0, tree, 0, 1);
+    if (! expander.check_capacity(static_cast<unsigned short>(nu_children)))
+        return false;
+    for (unsigned i = 0; i < nu_children; ++i)
+        expander.add_child({i}, 0.5, 0, 1);
+    expander.link_children(tree, node);
+    return true;
+}
+
+const Node& get_child(const Tree& tree, const Node& node, unsigned i)
+{
+    return tree.get_children(node).begin()[i];
+}
+
+/** Create a tree with 10 nodes: the root with 3 children and 3 children for
+    the first two children. The first child has a visit count of 10, the
+    others a visit count of 1. */
+void init_tree(Tree& tree)
+{
+    auto& root = tree.get_root();
+    LIBBOARDGAME_CHECK(expand(tree, root, 3));
+    LIBBOARDGAME_CHECK(expand(tree, get_child(tree, root, 0), 3));
+    LIBBOARDGAME_CHECK(expand(tree, get_child(tree, root, 1), 3));
+    tree.set_visit_count(get_child(tree, root, 0), 10);
+    tree.set_visit_count(get_child(tree, root, 1), 1);
+    tree.set_visit_count(get_child(tree, root, 2), 1);
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_tree_make_root)
+{
+    Tree tree(10 * sizeof(Node), 1);
+    init_tree(tree);
+    auto& root = tree.get_root();
+    tree.make_root(get_child(tree, root, 0));
+    LIBBOARDGAME_CHECK_EQUAL(tree.get_nu_nodes(), 4u);
+    LIBBOARDGAME_CHECK_EQUAL(root.get_visit_count(), 10.f);
+    LIBBOARDGAME_CHECK_EQUAL(root.get_nu_children(), 3);
+    // Freed memory can be reused
+    LIBBOARDGAME_CHECK(expand(tree, get_child(tree, root, 0), 3));
+    LIBBOARDGAME_CHECK(expand(tree, get_child(tree, root, 1), 3));
+    LIBBOARDGAME_CHECK(! expand(tree, get_child(tree, root, 2), 1));
+}
+
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_tree_prune)
+{
+    Tree tree(10 * sizeof(Node), 1);
+    init_tree(tree);
+    auto& root = tree.get_root();
+    LIBBOARDGAME_CHECK(! expand(tree, get_child(tree, root, 2), 3));
+    LIBBOARDGAME_CHECK_EQUAL(tree.prune(5), 3u);
+    LIBBOARDGAME_CHECK(get_child(tree, root, 1).is_unexpanded());
+    LIBBOARDGAME_CHECK_EQUAL(get_child(tree, root, 0).get_nu_children(), 3);
+    LIBBOARDGAME_CHECK_EQUAL(tree.get_nu_nodes(), 7u);
+    LIBBOARDGAME_CHECK(expand(tree, get_child(tree, root, 2), 3));
+    LIBBOARDGAME_CHECK_EQUAL(tree.get_nu_nodes(), 10u);
+}
+
+/** Test that prune() and make_root() do not free children that are still
+    reachable from another node if nodes share children. */
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_tree_shared_children)
+{
+    Tree tree(10 * sizeof(Node), 1);
+    tree.set_allow_shared_children(true);
+    init_tree(tree);
+    auto& root = tree.get_root();
+    auto first_child = get_child(tree, root, 0).get_first_child();
+    tree.link_shared_children(get_child(tree, root, 2), first_child, 3);
+    LIBBOARDGAME_CHECK_EQUAL(tree.prune(5), 3u);
+    LIBBOARDGAME_CHECK(get_child(tree, root, 2).is_unexpanded());
+    LIBBOARDGAME_CHECK_EQUAL(get_child(tree, root, 0).get_nu_children(), 3);
+    LIBBOARDGAME_CHECK_EQUAL(tree.get_nu_nodes(), 7u);
+    LIBBOARDGAME_CHECK(expand(tree, get_child(tree, root, 1), 3));
+    tree.link_shared_children(get_child(tree, root, 2), first_child, 3);
+    tree.make_root(get_child(tree, root, 2));
+    LIBBOARDGAME_CHECK_EQUAL(tree.get_nu_nodes(), 4u);
+    LIBBOARDGAME_CHECK_EQUAL(root.get_first_child(), first_child);
+    LIBBOARDGAME_CHECK_EQUAL(root.get_nu_children(), 3);
+}
+
+/** Test that prune() unlinks all nodes that share a freed block of children
+    if the visit count of one of them reaches the minimum count after the
+    nodes to keep were determined. */
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_tree_prune_shared_count_changed)
+{
+    Tree tree(10 * sizeof(Node), 1);
+    tree.set_allow_shared_children(true);
+    init_tree(tree);
+    auto& root = tree.get_root();
+    auto& node = get_child(tree, root, 2);
+    tree.link_shared_children(node, get_child(tree, root, 1).get_first_child(),
+                              3);
+    LIBBOARDGAME_CHECK_EQUAL(tree.prune(5, [&] {
+        tree.set_visit_count(node, 10);
+    }), 3u);
+    LIBBOARDGAME_CHECK(get_child(tree, root, 1).is_unexpanded());
+    LIBBOARDGAME_CHECK(node.is_unexpanded());
+    LIBBOARDGAME_CHECK_EQUAL(tree.get_nu_nodes(), 7u);
+    // The freed block is reused and not reachable from node
+    LIBBOARDGAME_CHECK(expand(tree, get_child(tree, root, 1), 3));
+    LIBBOARDGAME_CHECK(node.is_unexpanded());
+}
+
+/** Test that make_root() frees a block of children that was lost because it
+    was linked to a node of a subtree by a thread that accessed the tree while
+    the subtree was pruned. */
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_tree_make_root_lost_block)
+{
+    Tree tree(13 * sizeof(Node), 1);
+    init_tree(tree);
+    auto& root = tree.get_root();
+    auto& node = get_child(tree, get_child(tree, root, 1), 0);
+    tree.begin_access(0);
+    LIBBOARDGAME_CHECK_EQUAL(tree.prune(5), 3u);
+    LIBBOARDGAME_CHECK(expand(tree, node, 3));
+    tree.end_access(0);
+    LIBBOARDGAME_CHECK_EQUAL(tree.get_nu_nodes(), 10u);
+    tree.make_root(get_child(tree, root, 0));
+    LIBBOARDGAME_CHECK_EQUAL(tree.get_nu_nodes(), 4u);
+    for (unsigned i = 0; i < 3; ++i)
+        LIBBOARDGAME_CHECK(expand(tree, get_child(tree, root, i), 3));
+    LIBBOARDGAME_CHECK_EQUAL(tree.get_nu_nodes(), 13u);
+}
+
+/** Test that pruned nodes are not reused while a thread accessed the tree
+    during the pruning. */
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_tree_prune_grace_period)
+{
+    Tree tree(10 * sizeof(Node), 1);
+    init_tree(tree);
+    auto& root = tree.get_root();
+    tree.begin_access(0);
+    LIBBOARDGAME_CHECK_EQUAL(tree.prune(5), 3u);
+    LIBBOARDGAME_CHECK(tree.has_pending(0));
+    LIBBOARDGAME_CHECK(! expand(tree, get_child(tree, root, 2), 3));
+    tree.end_access(0);
+    LIBBOARDGAME_CHECK(expand(tree, get_child(tree, root, 2), 3));
+    LIBBOARDGAME_CHECK(! tree.has_pending(0));
+}
+
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_tree_save_load)
+{
+    const string file = "libboardgame_mcts_tree_save_load.tmp";
+    Tree tree(20 * sizeof(Node), 2);
+    init_tree(tree);
+    auto& root = tree.get_root();
+    tree.make_root(get_child(tree, root, 0));
+    tree.save(file, "user data");
+    Tree loaded_tree(0, 1);
+    string user_data;
+    loaded_tree.load(file, user_data);
+    remove(file.c_str());
+    LIBBOARDGAME_CHECK_EQUAL(user_data, "user data");
+    LIBBOARDGAME_CHECK_EQUAL(loaded_tree.get_nu_threads(), 2u);
+    LIBBOARDGAME_CHECK_EQUAL(loaded_tree.get_max_nodes(), 20u);
+    LIBBOARDGAME_CHECK_EQUAL(loaded_tree.get_nu_nodes(), 4u);
+    auto& loaded_root = loaded_tree.get_root();
+    LIBBOARDGAME_CHECK_EQUAL(loaded_root.get_visit_count(), 10.f);
+    LIBBOARDGAME_CHECK_EQUAL(loaded_root.get_nu_children(), 3);
+    // Freed and unused memory can be reused
+    LIBBOARDGAME_CHECK(expand(loaded_tree,
+                              get_child(loaded_tree, loaded_root, 0), 3));
+    LIBBOARDGAME_CHECK(expand(loaded_tree,
+                              get_child(loaded_tree, loaded_root, 1), 3));
+    LIBBOARDGAME_CHECK_EQUAL(loaded_tree.get_nu_nodes(), 10u);
+}
+
+/** Test that load() rejects files with sizes in the header that do not fit
+    the file. */
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_tree_load_invalid_size)
+{
+    const string file = "libboardgame_mcts_tree_load_invalid_size.tmp";
+    Tree tree(20 * sizeof(Node), 2);
+    init_tree(tree);
+    // Offsets of nodes_offset and user_data_size in the file header
+    for (streamoff offset : { 40, 48 })
+    {
+        tree.save(file, "user data");
+        {
+            fstream f(file, ios::binary | ios::in | ios::out);
+            f.seekp(offset);
+            uint64_t size = numeric_limits<uint64_t>::max() / 2;
+            f.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        }
+        Tree loaded_tree(0, 1);
+        string user_data;
+        LIBBOARDGAME_CHECK_THROW(loaded_tree.load(file, user_data),
+                                 runtime_error);
+    }
+    remove(file.c_str());
+}
+
+/** Test copying a subtree to a tree with a different number of threads. */
+LIBBOARDGAME_TEST_CASE(libboardgame_mcts_tree_copy_subtree)
+{
+    Tree tree(10 * sizeof(Node), 1);
+    init_tree(tree);
+    Tree target(20 * sizeof(Node), 2);
+    tree.copy_subtree(target, target.get_root(), tree.get_root(), 0);
+    LIBBOARDGAME_CHECK_EQUAL(target.get_nu_nodes(), 10u);
+    // Subtrees that don't fit are not copied
+    Tree small_target(10 * sizeof(Node), 2);
+    tree.copy_subtree(small_target, small_target.get_root(), tree.get_root(),
+                      0);
+    LIBBOARDGAME_CHECK_EQUAL(small_target.get_nu_nodes(), 4u);
+}
+
+//-----------------------------------------------------------------------------
@@ -306,6 +306,7 @@ void Board::init(Variant variant, const Setup* setup)
         m_attach_points[c].clear();
     }
     m_state_base.nu_onboard_pieces_all = 0;
+    m_state_base.hash = 0;
     if (setup == nullptr)
     {
         m_setup.clear();
@@ -533,6 +534,7 @@ void Board::take_snapshot()
     m_snapshot.state_base.to_play = m_state_base.to_play;
     m_snapshot.state_base.nu_onboard_pieces_all =
         m_state_base.nu_onboard_pieces_all;
+    m_snapshot.state_base.hash = m_state_base.hash;
     m_snapshot.state_base.point_state.copy_from(m_state_base.point_state,
                                                 *m_geo);
     for (Color c : get_colors())
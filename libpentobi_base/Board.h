@@ -17,6 +17,7 @@
 #include "Setup.h"
 #include "StartingPoints.h"
 #include "Variant.h"
+#include "Zobrist.h"
 
 namespace libpentobi_base {
 
@@ -175,6 +176,13 @@ public:
 
     void write(ostream& out, bool mark_last_move = true) const;
 
+    /** Get a Zobrist hash of the position.
+        The hash covers the point states, the pieces left of each color and
+        the color to play. Positions with the same hash can be reached by
+        different move sequences. The hash does not depend on the program
+        run, see Zobrist. */
+    uint_least64_t get_hash() const;
+
     /** Get the setup of the board before any moves were played.
         If the board was initialized without setup, the return value contains
         a setup with empty placement lists and Color(0) as the color to
@@ -354,6 +362,10 @@ private:
 
         unsigned nu_onboard_pieces_all;
 
+        /** Hash of the position without the color to play.
+            See get_hash() */
+        uint_least64_t hash;
+
         PointStateGrid point_state;
     };
 
@@ -567,6 +579,11 @@ inline Color Board::get_next(Color c) const
     return c.get_next(m_nu_colors);
 }
 
+inline uint_least64_t Board::get_hash() const
+{
+    return m_state_base.hash ^ Zobrist::get_to_play_key(m_state_base.to_play);
+}
+
 inline Color::IntType Board::get_nu_colors() const
 {
     return m_nu_colors;
@@ -798,7 +815,9 @@ inline void Board::place(Color c, Move mv)
     auto& state_color = m_state_color[c];
     LIBBOARDGAME_ASSERT(state_color.nu_left_piece[piece] > 0);
     auto score_points = m_score_points[piece];
-    if (--state_color.nu_left_piece[piece] == 0)
+    auto nu_left = --state_color.nu_left_piece[piece];
+    m_state_base.hash ^= Zobrist::get_piece_key(c, piece, nu_left);
+    if (nu_left == 0)
     {
         state_color.pieces_left.remove_fast(piece);
         if (MAX_SIZE == 22) // GembloQ
@@ -823,6 +842,7 @@ inline void Board::place(Color c, Move mv)
     do
     {
         m_state_base.point_state[*i] = PointState(c);
+        m_state_base.hash ^= Zobrist::get_point_key(c, *i);
         for_each_color([&](Color c) {
             m_state_color[c].forbidden[*i] = true;
         });
@@ -876,6 +896,7 @@ inline void Board::restore_snapshot()
     m_state_base.to_play = m_snapshot.state_base.to_play;
     m_state_base.nu_onboard_pieces_all =
         m_snapshot.state_base.nu_onboard_pieces_all;
+    m_state_base.hash = m_snapshot.state_base.hash;
     m_state_base.point_state.memcpy_from(m_snapshot.state_base.point_state,
                                          geo);
     for (Color c : get_colors())
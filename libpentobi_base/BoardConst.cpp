@@ -7,16 +7,26 @@
 #include "BoardConst.h"
 
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
 #include "Marker.h"
 #include "PieceTransformsClassic.h"
 #include "PieceTransformsGembloQ.h"
 #include "PieceTransformsTrigon.h"
 #include "libboardgame_base/Compiler.h"
 #include "libboardgame_base/Log.h"
+#include "libboardgame_base/ThreadPool.h"
 
 namespace libpentobi_base {
 
 using libboardgame_base::get_type_name;
+using libboardgame_base::PageMemory;
+using libboardgame_base::TaskGroup;
 
 //-----------------------------------------------------------------------------
 
@@ -24,16 +34,8 @@ namespace {
 
 const bool log_move_creation = false;
 
-/** Local variable used during construction.
-    Making this variable global slightly speeds up construction and a
-    thread-safe construction is not needed. */
-Marker g_marker;
-
-/** Non-compact representation of lists of moves of a piece at a point
-    constrained by the forbidden status of adjacent points.
-    Only used during construction. See g_marker why this variable is global. */
-Grid<array<ArrayList<Move, 44>, PrecompMoves::nu_adj_status>>
-    g_full_move_table;
+/** See BoardConst::set_cache_dir() */
+string g_cache_dir;
 
 
 bool is_reverse(MovePoints::const_iterator begin1, const Point* begin2, unsigned size)
@@ -808,6 +810,21 @@ vector<PieceInfo> create_pieces_nexos(const Geometry& geo,
 
 //-----------------------------------------------------------------------------
 
+/** Data that is only used while creating the moves.
+    Allocated on the heap because of its size and not shared between
+    instances, which allows constructing instances in parallel. */
+struct BoardConst::CreateMovesData
+{
+    Marker marker;
+
+    /** Non-compact representation of lists of moves of a piece at a point
+        constrained by the forbidden status of adjacent points. */
+    Grid<array<ArrayList<Move, PrecompMoves::max_list_size>,
+               PrecompMoves::nu_adj_status>> full_move_table;
+};
+
+//-----------------------------------------------------------------------------
+
 BoardConst::BoardConst(BoardType board_type, PieceSet piece_set)
     : m_board_type(board_type),
       m_piece_set(piece_set),
@@ -863,32 +880,32 @@ BoardConst::BoardConst(BoardType board_type, PieceSet piece_set)
         m_pieces = create_pieces_classic(m_geo, *m_transforms);
         m_max_piece_size = 5;
         m_max_adj_attach = 16;
-        m_move_info.reset(calloc(m_range, sizeof(MoveInfo<5>)));
-        m_move_info_ext.reset(calloc(m_range, sizeof(MoveInfoExt<16>)));
+        m_move_info_size = sizeof(MoveInfo<5>);
+        m_move_info_ext_size = sizeof(MoveInfoExt<16>);
         break;
     case PieceSet::junior:
         m_transforms = make_unique<PieceTransformsClassic>();
         m_pieces = create_pieces_junior(m_geo, *m_transforms);
         m_max_piece_size = 5;
         m_max_adj_attach = 16;
-        m_move_info.reset(calloc(m_range, sizeof(MoveInfo<5>)));
-        m_move_info_ext.reset(calloc(m_range, sizeof(MoveInfoExt<16>)));
+        m_move_info_size = sizeof(MoveInfo<5>);
+        m_move_info_ext_size = sizeof(MoveInfoExt<16>);
         break;
     case PieceSet::trigon:
         m_transforms = make_unique<PieceTransformsTrigon>();
         m_pieces = create_pieces_trigon(m_geo, *m_transforms);
         m_max_piece_size = 6;
         m_max_adj_attach = 22;
-        m_move_info.reset(calloc(m_range, sizeof(MoveInfo<6>)));
-        m_move_info_ext.reset(calloc(m_range, sizeof(MoveInfoExt<22>)));
+        m_move_info_size = sizeof(MoveInfo<6>);
+        m_move_info_ext_size = sizeof(MoveInfoExt<22>);
         break;
     case PieceSet::nexos:
         m_transforms = make_unique<PieceTransformsClassic>();
         m_pieces = create_pieces_nexos(m_geo, *m_transforms);
         m_max_piece_size = 7;
         m_max_adj_attach = 12;
-        m_move_info.reset(calloc(m_range, sizeof(MoveInfo<7>)));
-        m_move_info_ext.reset(calloc(m_range, sizeof(MoveInfoExt<12>)));
+        m_move_info_size = sizeof(MoveInfo<7>);
+        m_move_info_ext_size = sizeof(MoveInfoExt<12>);
         break;
     case PieceSet::callisto:
         m_transforms = make_unique<PieceTransformsClassic>();
@@ -899,19 +916,18 @@ BoardConst::BoardConst(BoardType board_type, PieceSet piece_set)
         // faster if we don't have to handle different values for
         // m_max_adj_attach for the same m_max_piece_size.
         m_max_adj_attach = 16;
-        m_move_info.reset(calloc(m_range, sizeof(MoveInfo<5>)));
-        m_move_info_ext.reset(calloc(m_range, sizeof(MoveInfoExt<16>)));
+        m_move_info_size = sizeof(MoveInfo<5>);
+        m_move_info_ext_size = sizeof(MoveInfoExt<16>);
         break;
     case PieceSet::gembloq:
         m_transforms = make_unique<PieceTransformsGembloQ>();
         m_pieces = create_pieces_gembloq(m_geo, *m_transforms);
         m_max_piece_size = 22;
         m_max_adj_attach = 44;
-        m_move_info.reset(calloc(m_range, sizeof(MoveInfo<22>)));
-        m_move_info_ext.reset(calloc(m_range, sizeof(MoveInfoExt<44>)));
+        m_move_info_size = sizeof(MoveInfo<22>);
+        m_move_info_ext_size = sizeof(MoveInfoExt<44>);
         break;
     }
-    m_move_info_ext_2 = make_unique<MoveInfoExt2[]>(m_range);
     m_nu_pieces = static_cast<Piece::IntType>(m_pieces.size());
     for (Point p : m_geo)
         if (has_adj_status_points(p))
@@ -921,7 +937,34 @@ BoardConst::BoardConst(BoardType board_type, PieceSet piece_set)
     for (Point p : m_geo)
         m_compare_val[p] =
                 (height - m_geo.get_y(p) - 1) * width + m_geo.get_x(p);
-    create_moves();
+    bool has_symmetry =
+            (board_type == BoardType::duo
+             || board_type == BoardType::callisto_2
+             || board_type == BoardType::trigon
+             || board_type == BoardType::gembloq_2);
+    if (has_symmetry)
+        m_symmetric_points.init(m_geo);
+    string cache_file;
+    if (! g_cache_dir.empty())
+        cache_file = g_cache_dir + "/boardconst-"
+                + std::to_string(static_cast<int>(board_type)) + "-"
+                + std::to_string(static_cast<int>(piece_set)) + ".dat";
+    if (cache_file.empty() || ! load_cache(cache_file))
+    {
+        set_tables(PageMemory(get_tables_layout().size, false));
+        create_moves();
+        if (has_symmetry)
+        {
+            if (m_max_piece_size == 5)
+                init_symmetry_info<5>();
+            else if (m_max_piece_size == 6)
+                init_symmetry_info<6>();
+            else
+                init_symmetry_info<22>();
+        }
+        if (! cache_file.empty())
+            save_cache(cache_file);
+    }
     switch (piece_set)
     {
     case PieceSet::classic:
@@ -943,28 +986,24 @@ BoardConst::BoardConst(BoardType board_type, PieceSet piece_set)
         LIBBOARDGAME_ASSERT(m_nu_pieces == 21);
         break;
     }
-    if (board_type == BoardType::duo || board_type == BoardType::callisto_2)
-        init_symmetry_info<5>();
-    else if (board_type == BoardType::trigon)
-        init_symmetry_info<6>();
-    else if (board_type == BoardType::gembloq_2)
-        init_symmetry_info<22>();
 }
 
 template<unsigned MAX_SIZE, unsigned MAX_ADJ_ATTACH>
-inline void BoardConst::create_move(unsigned& moves_created, Piece piece,
+inline void BoardConst::create_move(CreateMovesData& data,
+                                    unsigned& moves_created, Piece piece,
                                     const MovePoints& points, Point label_pos)
 {
     LIBBOARDGAME_ASSERT(m_max_piece_size == MAX_SIZE);
     LIBBOARDGAME_ASSERT(m_max_adj_attach == MAX_ADJ_ATTACH);
     LIBBOARDGAME_ASSERT(moves_created < m_range);
+    auto& marker = data.marker;
     Move mv(static_cast<Move::IntType>(moves_created));
     void* place =
-            static_cast<MoveInfo<MAX_SIZE>*>(m_move_info.get())
+            static_cast<MoveInfo<MAX_SIZE>*>(m_move_info)
             + moves_created;
     new(place) MoveInfo<MAX_SIZE>(piece, points);
     place =
-            static_cast<MoveInfoExt<MAX_ADJ_ATTACH>*>(m_move_info_ext.get())
+            static_cast<MoveInfoExt<MAX_ADJ_ATTACH>*>(m_move_info_ext)
             + moves_created;
     auto& info_ext = *new(place) MoveInfoExt<MAX_ADJ_ATTACH>();
     auto& info_ext_2 = m_move_info_ext_2[moves_created];
@@ -977,34 +1016,34 @@ inline void BoardConst::create_move(unsigned& moves_created, Piece piece,
                 scored_points - &info_ext_2.scored_points[0]);
     auto begin = info_ext_2.begin_scored_points();
     auto end = info_ext_2.end_scored_points();
-    g_marker.clear();
+    marker.clear();
     for (auto i = begin; i != end; ++i)
-        g_marker.set(*i);
+        marker.set(*i);
     for (auto i = begin; i != end; ++i)
     {
         LIBBOARDGAME_ASSERT(has_adj_status_points(*i));
         auto j = m_adj_status_points[*i].begin();
-        unsigned adj_status = g_marker[*j];
+        unsigned adj_status = marker[*j];
         for (unsigned k = 1; k < PrecompMoves::adj_status_nu_adj; ++k)
-            adj_status |= (g_marker[*(++j)] << k);
+            adj_status |= (marker[*(++j)] << k);
         for (unsigned j = 0; j < PrecompMoves::nu_adj_status; ++j)
             if ((j & adj_status) == 0)
-                g_full_move_table[*i][j].push_back(mv);
+                data.full_move_table[*i][j].push_back(mv);
     }
     Point* p = info_ext.points;
     for (auto i = begin; i != end; ++i)
         for (Point j : m_geo.get_adj(*i))
-            if (! g_marker[j])
+            if (! marker[j])
             {
-                g_marker.set(j);
+                marker.set(j);
                 *(p++) = j;
             }
     info_ext.size_adj_points = static_cast<uint_least8_t>(p - info_ext.points);
     for (auto i = begin; i != end; ++i)
         for (Point j : m_geo.get_diag(*i))
-            if (! g_marker[j])
+            if (! marker[j])
             {
-                g_marker.set(j);
+                marker.set(j);
                 *(p++) = j;
             }
     info_ext.size_attach_points =
@@ -1034,27 +1073,27 @@ void BoardConst::create_moves()
     // Unused move infos for Move::null()
     LIBBOARDGAME_ASSERT(Move::null().to_int() == 0);
     unsigned moves_created = 1;
-
+    auto data = make_unique<CreateMovesData>();
     unsigned n = 0;
     for (Piece::IntType i = 0; i < m_nu_pieces; ++i)
     {
         Piece piece(i);
         if (m_max_piece_size == 5)
-            create_moves<5, 16>(moves_created, piece);
+            create_moves<5, 16>(*data, moves_created, piece);
         else if (m_max_piece_size == 6)
-            create_moves<6, 22>(moves_created, piece);
+            create_moves<6, 22>(*data, moves_created, piece);
         else if (m_max_piece_size == 7)
-            create_moves<7, 12>(moves_created, piece);
+            create_moves<7, 12>(*data, moves_created, piece);
         else
-            create_moves<22, 44>(moves_created, piece);
+            create_moves<22, 44>(*data, moves_created, piece);
         for (Point p : m_geo)
             for (unsigned j = 0; j < PrecompMoves::nu_adj_status; ++j)
                 {
-                    auto& list = g_full_move_table[p][j];
-                    m_precomp_moves.set_list_range(p, j, piece, n,
+                    auto& list = data->full_move_table[p][j];
+                    m_precomp_moves->set_list_range(p, j, piece, n,
                                                    list.size());
                     for (auto mv : list)
-                        m_precomp_moves.set_move(n++, mv);
+                        m_precomp_moves->set_move(n++, mv);
                     list.clear();
                 }
     }
@@ -1063,7 +1102,8 @@ void BoardConst::create_moves()
 }
 
 template<unsigned MAX_SIZE, unsigned MAX_ADJ_ATTACH>
-void BoardConst::create_moves(unsigned& moves_created, Piece piece)
+void BoardConst::create_moves(CreateMovesData& data,
+                              unsigned& moves_created, Piece piece)
 {
     auto& piece_info = m_pieces[piece.to_int()];
     if (log_move_creation)
@@ -1126,7 +1166,7 @@ void BoardConst::create_moves(unsigned& moves_created, Piece piece)
             label_pos.x += x;
             label_pos.y += y;
             create_move<MAX_SIZE, MAX_ADJ_ATTACH>(
-                        moves_created, piece, points,
+                        data, moves_created, piece, points,
                         m_geo.get_point(label_pos.x, label_pos.y));
         }
     }
@@ -1160,15 +1200,81 @@ bool BoardConst::from_string(Move& mv, const string& s) const
     return find_move(points, mv);
 }
 
+unique_ptr<BoardConst> BoardConst::create(Variant variant)
+{
+    return unique_ptr<BoardConst>(
+                new BoardConst(libpentobi_base::get_board_type(variant),
+                               libpentobi_base::get_piece_set(variant)));
+}
+
 const BoardConst& BoardConst::get(Variant variant)
 {
-    static map<BoardType, map<PieceSet, unique_ptr<BoardConst>>> board_const;
+    struct Entry
+    {
+        once_flag is_created;
+
+        unique_ptr<BoardConst> bc;
+    };
+
+    // The mutex protects only the map, so that instances for different keys
+    // can be created concurrently. Map elements are never moved.
+    static map<BoardType, map<PieceSet, Entry>> board_const;
+    static mutex board_const_mutex;
+
     auto board_type = libpentobi_base::get_board_type(variant);
     auto piece_set = libpentobi_base::get_piece_set(variant);
-    auto& bc = board_const[board_type][piece_set];
-    if (! bc)
-        bc.reset(new BoardConst(board_type, piece_set));
-    return *bc;
+    Entry* entry;
+    {
+        lock_guard lock(board_const_mutex);
+        entry = &board_const[board_type][piece_set];
+    }
+    call_once(entry->is_created, [&] {
+        entry->bc.reset(new BoardConst(board_type, piece_set));
+    });
+    return *entry->bc;
+}
+
+/** Get a checksum of the geometry and the pieces the tables are created
+    from.
+    Used for detecting cache files written by a build with different
+    definitions of the pieces or the geometry, which cannot be detected by
+    the sizes in the header of the cache file. */
+uint64_t BoardConst::get_cache_checksum() const
+{
+    // 64-bit FNV-1a
+    uint64_t checksum = 0xcbf29ce484222325;
+    auto add = [&](int i) {
+        auto val = static_cast<uint32_t>(i);
+        for (unsigned j = 0; j < 4; ++j, val >>= 8)
+            checksum = (checksum ^ (val & 0xff)) * 0x100000001b3;
+    };
+    add(static_cast<int>(m_geo.get_width()));
+    add(static_cast<int>(m_geo.get_height()));
+    for (Point p : m_geo)
+    {
+        add(static_cast<int>(p.to_int()));
+        add(static_cast<int>(m_geo.get_x(p)));
+        add(static_cast<int>(m_geo.get_y(p)));
+        for (Point adj : m_geo.get_adj(p))
+            add(static_cast<int>(adj.to_int()));
+        for (Point diag : m_geo.get_diag(p))
+            add(static_cast<int>(diag.to_int()));
+    }
+    for (auto& piece_info : m_pieces)
+    {
+        for (char c : piece_info.get_name())
+            add(c);
+        add(static_cast<int>(piece_info.get_nu_instances()));
+        add(piece_info.get_label_pos().x);
+        add(piece_info.get_label_pos().y);
+        for (auto& p : piece_info.get_points())
+        {
+            add(p.x);
+            add(p.y);
+        }
+        add(static_cast<int>(piece_info.get_transforms().size()));
+    }
+    return checksum;
 }
 
 Piece BoardConst::get_move_piece(Move mv) const
@@ -1194,6 +1300,20 @@ bool BoardConst::get_piece_by_name(const string& name, Piece& piece) const
     return false;
 }
 
+BoardConst::TablesLayout BoardConst::get_tables_layout() const
+{
+    auto align = [](size_t n) { return (n + 63) / 64 * 64; };
+    TablesLayout layout;
+    layout.move_info = 0;
+    layout.move_info_ext = align(m_range * m_move_info_size);
+    layout.move_info_ext_2 =
+            align(layout.move_info_ext + m_range * m_move_info_ext_size);
+    layout.precomp_moves =
+            align(layout.move_info_ext_2 + m_range * sizeof(MoveInfoExt2));
+    layout.size = layout.precomp_moves + sizeof(PrecompMoves);
+    return layout;
+}
+
 bool BoardConst::find_move(const MovePoints& points, Move& move) const
 {
     if (points.empty())
@@ -1292,7 +1412,6 @@ void BoardConst::init_adj_status_points(Point p)
 template<unsigned MAX_SIZE>
 void BoardConst::init_symmetry_info()
 {
-    m_symmetric_points.init(m_geo);
     for (Move::IntType i = 1; i < m_range; ++i)
     {
         Move mv(i);
@@ -1319,6 +1438,129 @@ void BoardConst::init_symmetry_info()
     }
 }
 
+bool BoardConst::load_cache(const string& file)
+{
+    ifstream in(file, ios::binary);
+    if (! in)
+        return false;
+    CacheHeader header;
+    if (! in.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0
+            || header.version != cache_version
+            || header.byte_order != cache_byte_order
+            || header.board_type != static_cast<uint32_t>(m_board_type)
+            || header.piece_set != static_cast<uint32_t>(m_piece_set)
+            || header.range != m_range
+            || header.move_info_size != m_move_info_size
+            || header.move_info_ext_size != m_move_info_ext_size
+            || header.move_info_ext_2_size != sizeof(MoveInfoExt2)
+            || header.precomp_moves_size != sizeof(PrecompMoves)
+            || header.checksum != get_cache_checksum()
+            || header.tables_size != get_tables_layout().size)
+    {
+        LIBBOARDGAME_LOG("Ignoring incompatible cache file ", file);
+        return false;
+    }
+    in.close();
+    try
+    {
+        set_tables(PageMemory(file, header.tables_offset,
+                              header.tables_size));
+    }
+    catch (const runtime_error& e)
+    {
+        LIBBOARDGAME_LOG("Could not load cache file: ", e.what());
+        return false;
+    }
+    for (Piece::IntType i = 0; i < m_nu_pieces; ++i)
+        m_nu_attach_points[Piece(i)] = header.nu_attach_points[i];
+    LIBBOARDGAME_LOG("Loaded moves from ", file);
+    return true;
+}
+
+void BoardConst::preload(const vector<Variant>& variants)
+{
+    set<pair<BoardType, PieceSet>> created;
+    TaskGroup group;
+    for (auto variant : variants)
+        if (created.emplace(libpentobi_base::get_board_type(variant),
+                            libpentobi_base::get_piece_set(variant)).second)
+            group.run([variant] { get(variant); });
+    group.wait();
+}
+
+/** Write the tables to a cache file.
+    The file is written under a temporary name and then renamed, so that
+    other processes never map a partially written file. Blocks of the tables
+    that contain only zeros are not written, which makes the file sparse on
+    file systems that support it (the precomputed moves are allocated for
+    the largest game variant). */
+void BoardConst::save_cache(const string& file) const
+{
+    auto alignment = PageMemory::file_alignment;
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.byte_order = cache_byte_order;
+    header.board_type = static_cast<uint32_t>(m_board_type);
+    header.piece_set = static_cast<uint32_t>(m_piece_set);
+    header.range = m_range;
+    header.move_info_size = static_cast<uint32_t>(m_move_info_size);
+    header.move_info_ext_size = static_cast<uint32_t>(m_move_info_ext_size);
+    header.move_info_ext_2_size = sizeof(MoveInfoExt2);
+    header.precomp_moves_size = sizeof(PrecompMoves);
+    for (Piece::IntType i = 0; i < m_nu_pieces; ++i)
+        header.nu_attach_points[i] = m_nu_attach_points[Piece(i)];
+    header.checksum = get_cache_checksum();
+    header.tables_offset =
+            (sizeof(header) + alignment - 1) / alignment * alignment;
+    header.tables_size = get_tables_layout().size;
+    auto tmp_file = file + ".tmp" + std::to_string(random_device()());
+    ofstream out(tmp_file, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    auto tables = static_cast<const char*>(m_tables.get());
+    auto is_zero = [](const char* begin, const char* end) {
+        return all_of(begin, end, [](char c) { return c == 0; });
+    };
+    for (uint64_t pos = 0; pos < header.tables_size; pos += alignment)
+    {
+        auto size = min(uint64_t(alignment), header.tables_size - pos);
+        if (is_zero(tables + pos, tables + pos + size))
+            continue;
+        out.seekp(static_cast<streamoff>(header.tables_offset + pos));
+        out.write(tables + pos, static_cast<streamsize>(size));
+    }
+    // The file must contain the whole tables for mapping them in load_cache()
+    out.seekp(static_cast<streamoff>(header.tables_offset
+                                     + header.tables_size - 1));
+    out.put(tables[header.tables_size - 1]);
+    out.close();
+    if (! out || rename(tmp_file.c_str(), file.c_str()) != 0)
+    {
+        LIBBOARDGAME_LOG("Could not write cache file ", file);
+        remove(tmp_file.c_str());
+    }
+}
+
+void BoardConst::set_cache_dir(const string& dir)
+{
+    g_cache_dir = dir;
+}
+
+void BoardConst::set_tables(PageMemory memory)
+{
+    m_tables = move(memory);
+    auto layout = get_tables_layout();
+    auto tables = static_cast<char*>(m_tables.get());
+    m_move_info = tables + layout.move_info;
+    m_move_info_ext = tables + layout.move_info_ext;
+    m_move_info_ext_2 =
+            reinterpret_cast<MoveInfoExt2*>(tables + layout.move_info_ext_2);
+    m_precomp_moves =
+            reinterpret_cast<PrecompMoves*>(tables + layout.precomp_moves);
+}
+
 void BoardConst::sort(MovePoints& points) const
 {
     auto less = [this](Point a, Point b)
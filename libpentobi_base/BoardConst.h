@@ -12,6 +12,7 @@
 #include "PrecompMoves.h"
 #include "SymmetricPoints.h"
 #include "Variant.h"
+#include "libboardgame_base/Memory.h"
 #include "libboardgame_base/Range.h"
 
 namespace libpentobi_base {
@@ -41,9 +42,35 @@ public:
 
     /** Get the single instance for a given board size.
         The instance is created the first time this function is called.
-        This function is not thread-safe. */
+        This function is thread-safe. Instances for different board types
+        or piece sets can be created concurrently. */
     static const BoardConst& get(Variant variant);
 
+    /** Create a new instance that is not shared.
+        Only used for testing the cache files (see set_cache_dir()), other
+        code should use get(). */
+    static unique_ptr<BoardConst> create(Variant variant);
+
+    /** Create the instances for several game variants in parallel.
+        Uses the global thread pool (see
+        libboardgame_base::ThreadPool::get_global()). Game variants that
+        share an instance or whose instance already exists are only created
+        once. */
+    static void preload(const vector<Variant>& variants);
+
+    /** Set a directory for caching the move tables.
+        If the directory is not empty, get() maps the move info arrays and
+        the precomputed moves copy-on-write from a cache file in this
+        directory, which is faster than computing them and allows processes
+        to share the memory pages. If there is no compatible cache file, the
+        tables are computed and the file is written. Errors reading or
+        writing the cache file are logged and otherwise ignored. The cache
+        files depend on the platform and on the build configuration, so
+        different builds should use different directories.
+        This function is not thread-safe and only affects instances created
+        after it was called. */
+    static void set_cache_dir(const string& dir);
+
     template<unsigned MAX_SIZE>
     static const MoveInfo<MAX_SIZE>&
     get_move_info(Move mv, MoveInfoArray move_info_array);
@@ -83,7 +110,7 @@ public:
     template<unsigned MAX_SIZE>
     Piece get_move_piece(Move mv) const;
 
-    MoveInfoArray get_move_info_array() const { return m_move_info.get(); }
+    MoveInfoArray get_move_info_array() const { return m_move_info; }
 
     /** Get pointer to extended move info array.
         Can be used to speed up the access to the move info by avoiding the
@@ -105,10 +132,10 @@ public:
     PrecompMoves::Range get_moves(Piece piece, Point p,
                                   unsigned adj_status = 0) const
     {
-        return m_precomp_moves.get_moves(piece, p, adj_status);
+        return m_precomp_moves->get_moves(piece, p, adj_status);
     }
 
-    const PrecompMoves& get_precomp_moves() const { return m_precomp_moves; }
+    const PrecompMoves& get_precomp_moves() const { return *m_precomp_moves; }
 
     BoardType get_board_type() const { return m_board_type; }
 
@@ -153,11 +180,68 @@ public:
     void sort(MovePoints& points) const;
 
 private:
-    struct MallocFree
+    /** Header of the cache files (see set_cache_dir()).
+        The tables start at tables_offset and have the same layout as in
+        m_tables. */
+    struct CacheHeader
     {
-        void operator()(void* x) { free(x); }
+        char magic[8];
+
+        uint32_t version;
+
+        /** Detects files written on platforms with different byte order. */
+        uint32_t byte_order;
+
+        uint32_t board_type;
+
+        uint32_t piece_set;
+
+        uint32_t range;
+
+        uint32_t move_info_size;
+
+        uint32_t move_info_ext_size;
+
+        uint32_t move_info_ext_2_size;
+
+        uint32_t precomp_moves_size;
+
+        uint32_t nu_attach_points[Piece::max_pieces];
+
+        /** See get_cache_checksum() */
+        uint64_t checksum;
+
+        uint64_t tables_offset;
+
+        uint64_t tables_size;
     };
 
+    struct CreateMovesData;
+
+    /** Offsets of the tables in m_tables. */
+    struct TablesLayout
+    {
+        size_t move_info;
+
+        size_t move_info_ext;
+
+        size_t move_info_ext_2;
+
+        size_t precomp_moves;
+
+        size_t size;
+    };
+
+    static constexpr char cache_magic[8] = { 'L', 'P', 'B', 'C', 'O', 'N',
+                                             'S', 'T' };
+
+    /** Version of the cache files.
+        Must be incremented if the file format or the content of the tables
+        changes. */
+    static constexpr uint32_t cache_version = 2;
+
+    static constexpr uint32_t cache_byte_order = 0x01020304;
+
 
     Piece::IntType m_nu_pieces;
 
@@ -182,20 +266,31 @@ private:
 
     PieceMap<unsigned> m_nu_attach_points{0};
 
+    /** Size of the elements of m_move_info. */
+    size_t m_move_info_size;
+
+    /** Size of the elements of m_move_info_ext. */
+    size_t m_move_info_ext_size;
+
+    /** Memory containing the move info arrays and the precomputed moves.
+        Either allocated or mapped from a cache file.
+        See get_tables_layout() */
+    libboardgame_base::PageMemory m_tables;
+
     /** Array of MoveInfo<MAX_SIZE> with MAX_SIZE being the maximum piece size
         in the corresponding game variant.
         See comments at MoveInfo. */
-    unique_ptr<void, MallocFree> m_move_info;
+    void* m_move_info;
 
     /** Array of MoveInfoExt<MAX_ADJ_ATTACH> with MAX_ADJ_ATTACH being the
         maximum total number of attach points and adjacent points of a piece in
         the corresponding game variant.
         See comments at MoveInfoExt. */
-    unique_ptr<void, MallocFree> m_move_info_ext;
+    void* m_move_info_ext;
 
-    unique_ptr<MoveInfoExt2[]> m_move_info_ext_2;
+    MoveInfoExt2* m_move_info_ext_2;
 
-    PrecompMoves m_precomp_moves;
+    PrecompMoves* m_precomp_moves;
 
     /** Value for comparing points using the ordering used in blksgf files.
         As specified in doc/blksgf/Pentobi-SGF.html, the order should be
@@ -209,19 +304,30 @@ private:
     BoardConst(BoardType board_type, PieceSet piece_set);
 
     template<unsigned MAX_SIZE, unsigned MAX_ADJ_ATTACH>
-    void create_move(unsigned& moves_created, Piece piece,
-                     const MovePoints& points, Point label_pos);
+    void create_move(CreateMovesData& data, unsigned& moves_created,
+                     Piece piece, const MovePoints& points, Point label_pos);
 
     void create_moves();
 
     template<unsigned MAX_SIZE, unsigned MAX_ADJ_ATTACH>
-    void create_moves(unsigned& moves_created, Piece piece);
+    void create_moves(CreateMovesData& data, unsigned& moves_created,
+                      Piece piece);
+
+    uint64_t get_cache_checksum() const;
 
     template<unsigned MAX_SIZE>
     const MoveInfo<MAX_SIZE>& get_move_info(Move mv) const;
 
+    TablesLayout get_tables_layout() const;
+
     void init_adj_status_points(Point p);
 
+    bool load_cache(const string& file);
+
+    void save_cache(const string& file) const;
+
+    void set_tables(libboardgame_base::PageMemory memory);
+
     template<unsigned MAX_SIZE>
     void init_symmetry_info();
 };
@@ -244,7 +350,7 @@ template<unsigned MAX_SIZE>
 inline const MoveInfo<MAX_SIZE>& BoardConst::get_move_info(Move mv) const
 {
     LIBBOARDGAME_ASSERT(m_max_piece_size == MAX_SIZE);
-    return get_move_info<MAX_SIZE>(mv, m_move_info.get());
+    return get_move_info<MAX_SIZE>(mv, m_move_info);
 }
 
 template<unsigned MAX_ADJ_ATTACH>
@@ -264,12 +370,12 @@ inline const MoveInfoExt2& BoardConst::get_move_info_ext_2(Move mv) const
 
 inline auto BoardConst::get_move_info_ext_array() const -> MoveInfoExtArray
 {
-    return m_move_info_ext.get();
+    return m_move_info_ext;
 }
 
 inline const MoveInfoExt2* BoardConst::get_move_info_ext_2_array() const
 {
-    return m_move_info_ext_2.get();
+    return m_move_info_ext_2;
 }
 
 template<unsigned MAX_SIZE>
@@ -8,6 +8,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 
 namespace libpentobi_base {
 
@@ -56,6 +57,9 @@ CallistoGeometry::CallistoGeometry(unsigned nu_colors)
 const CallistoGeometry& CallistoGeometry::get(unsigned nu_colors)
 {
     static map<unsigned, shared_ptr<CallistoGeometry>> s_geometry;
+    static mutex s_mutex;
+
+    lock_guard lock(s_mutex);
 
     auto pos = s_geometry.find(nu_colors);
     if (pos != s_geometry.end())
@@ -8,6 +8,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include "libboardgame_base/MathUtil.h"
 
 namespace libpentobi_base {
@@ -42,6 +43,9 @@ GembloQGeometry::GembloQGeometry(unsigned nu_players)
 const GembloQGeometry& GembloQGeometry::get(unsigned nu_players)
 {
     static map<unsigned, shared_ptr<GembloQGeometry>> s_geometry;
+    static mutex s_mutex;
+
+    lock_guard lock(s_mutex);
 
     auto pos = s_geometry.find(nu_players);
     if (pos != s_geometry.end())
@@ -7,6 +7,7 @@
 #include "NexosGeometry.h"
 
 #include <memory>
+#include <mutex>
 
 namespace libpentobi_base {
 
@@ -22,6 +23,9 @@ NexosGeometry::NexosGeometry()
 const NexosGeometry& NexosGeometry::get()
 {
     static unique_ptr<NexosGeometry> s_geometry;
+    static mutex s_mutex;
+
+    lock_guard lock(s_mutex);
 
     if (! s_geometry)
         s_geometry = make_unique<NexosGeometry>();
@@ -50,9 +50,39 @@ public:
     /** The range of values for the adjacent status. */
     static constexpr unsigned nu_adj_status = 1 << adj_status_nu_adj;
 
+    /** The maximum size of a move list in any game variant. */
+    static constexpr unsigned max_list_size = 44;
+
     /** Begin/end range for lists with moves at a given point. */
     using Range = libboardgame_base::Range<const Move>;
 
+    /** Begin and size of a move list packed into a single integer.
+        Also used by other containers of precomputed move lists. */
+    class CompressedRange
+    {
+    public:
+        CompressedRange() = default;
+
+        CompressedRange(unsigned begin, unsigned size)
+        {
+            LIBBOARDGAME_ASSERT(begin + size <= max_move_lists_sum_length);
+            static_assert(max_move_lists_sum_length < (1 << 24));
+            LIBBOARDGAME_ASSERT(size < (1 << 8));
+            m_val = size;
+            if (size != 0)
+                m_val |= (begin << 8);
+        }
+
+        bool empty() const { return m_val == 0; }
+
+        unsigned begin() const { return m_val >> 8; }
+
+        unsigned size() const { return m_val & 0xff; }
+
+    private:
+        uint_least32_t m_val;
+    };
+
 
     /** Add a move to list during construction. */
     void set_move(unsigned i, Move mv)
@@ -91,31 +121,6 @@ public:
     const Move* move_lists_begin() const { return &(*m_move_lists.begin()); }
 
 private:
-    class CompressedRange
-    {
-    public:
-        CompressedRange() = default;
-
-        CompressedRange(unsigned begin, unsigned size)
-        {
-            LIBBOARDGAME_ASSERT(begin + size <= max_move_lists_sum_length);
-            static_assert(max_move_lists_sum_length < (1 << 24));
-            LIBBOARDGAME_ASSERT(size < (1 << 8));
-            m_val = size;
-            if (size != 0)
-                m_val |= (begin << 8);
-        }
-
-        bool empty() const { return m_val == 0; }
-
-        unsigned begin() const { return m_val >> 8; }
-
-        unsigned size() const { return m_val & 0xff; }
-
-    private:
-        uint_least32_t m_val;
-    };
-
     /** See m_move_lists. */
     Grid<array<PieceMap<CompressedRange>, nu_adj_status>> m_moves_range;
 
@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------------
+/** @file libpentobi_base/Zobrist.h
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#ifndef LIBPENTOBI_BASE_ZOBRIST_H
+#define LIBPENTOBI_BASE_ZOBRIST_H
+
+#include <array>
+#include "Color.h"
+#include "Piece.h"
+#include "PieceInfo.h"
+#include "Point.h"
+
+namespace libpentobi_base {
+
+//-----------------------------------------------------------------------------
+
+/** Keys for Zobrist hashing of board positions.
+    The keys are generated at compile time with a fixed pseudo-random
+    sequence (SplitMix64), so hashes are the same in every run of the
+    program and can be stored in files. */
+class Zobrist
+{
+public:
+    /** Number of keys for use by the caller that are not used for the
+        board state. */
+    static constexpr unsigned nu_extra_keys = 8;
+
+    /** Key for a point occupied by a color. */
+    static uint_least64_t get_point_key(Color c, Point p);
+
+    /** Key for a piece instance that is not left anymore.
+        @param c The color
+        @param piece The piece
+        @param nu_left The number of instances of the piece left after
+        removing the instance. */
+    static uint_least64_t get_piece_key(Color c, Piece piece,
+                                        unsigned nu_left);
+
+    /** Key for the color to play. */
+    static uint_least64_t get_to_play_key(Color c);
+
+    /** Key for additional state that the caller includes in a hash.
+        @pre i < nu_extra_keys */
+    static uint_least64_t get_extra_key(unsigned i);
+
+private:
+    static constexpr unsigned point_keys_begin = 0;
+
+    static constexpr unsigned piece_keys_begin =
+            point_keys_begin + Color::range * Point::range;
+
+    static constexpr unsigned to_play_keys_begin =
+            piece_keys_begin
+            + Color::range * Piece::max_pieces * PieceInfo::max_instances;
+
+    static constexpr unsigned extra_keys_begin =
+            to_play_keys_begin + Color::range;
+
+    static constexpr unsigned nu_keys = extra_keys_begin + nu_extra_keys;
+
+    using KeyArray = array<uint_least64_t, nu_keys>;
+
+
+    static constexpr KeyArray create_keys();
+
+    static const KeyArray s_keys;
+};
+
+constexpr Zobrist::KeyArray Zobrist::create_keys()
+{
+    KeyArray keys{};
+    uint_least64_t x = 0;
+    for (unsigned i = 0; i < nu_keys; ++i)
+    {
+        x += 0x9e3779b97f4a7c15u;
+        auto z = x;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+        keys[i] = z ^ (z >> 31);
+    }
+    return keys;
+}
+
+inline constexpr Zobrist::KeyArray Zobrist::s_keys = Zobrist::create_keys();
+
+inline uint_least64_t Zobrist::get_extra_key(unsigned i)
+{
+    LIBBOARDGAME_ASSERT(i < nu_extra_keys);
+    return s_keys[extra_keys_begin + i];
+}
+
+inline uint_least64_t Zobrist::get_piece_key(Color c, Piece piece,
+                                             unsigned nu_left)
+{
+    LIBBOARDGAME_ASSERT(nu_left < PieceInfo::max_instances);
+    return s_keys[piece_keys_begin
+                  + (c.to_int() * Piece::max_pieces + piece.to_int())
+                  * PieceInfo::max_instances + nu_left];
+}
+
+inline uint_least64_t Zobrist::get_point_key(Color c, Point p)
+{
+    return s_keys[point_keys_begin + c.to_int() * Point::range + p.to_int()];
+}
+
+inline uint_least64_t Zobrist::get_to_play_key(Color c)
+{
+    return s_keys[to_play_keys_begin + c.to_int()];
+}
+
+//-----------------------------------------------------------------------------
+
+} // namespace libpentobi_base
+
+#endif // LIBPENTOBI_BASE_ZOBRIST_H
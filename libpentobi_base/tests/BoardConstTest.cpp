@@ -6,6 +6,9 @@
 
 #include "libpentobi_base/BoardConst.h"
 
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include "libboardgame_test/Test.h"
 
 using namespace std;
@@ -35,6 +38,84 @@ LIBBOARDGAME_TEST_CASE(pentobi_base_board_const_to_string_ordered)
     LIBBOARDGAME_CHECK_EQUAL(bc.to_string(mv), "j5,i6,j6,h7,i7");
 }
 
+/** Test that preload() creates the instances for all game variants in
+    parallel and that get() returns the same instances afterwards. */
+LIBBOARDGAME_TEST_CASE(pentobi_base_board_const_preload)
+{
+    vector<Variant> variants = { Variant::classic, Variant::classic_2,
+                                 Variant::junior, Variant::trigon,
+                                 Variant::nexos, Variant::callisto_2,
+                                 Variant::gembloq };
+    BoardConst::preload(variants);
+    auto& bc = BoardConst::get(Variant::classic);
+    LIBBOARDGAME_CHECK_EQUAL(&BoardConst::get(Variant::classic_2), &bc);
+    LIBBOARDGAME_CHECK_EQUAL(bc.get_range(),
+                             Move::onboard_moves_classic + 1);
+    LIBBOARDGAME_CHECK_EQUAL(BoardConst::get(Variant::trigon).get_range(),
+                             Move::onboard_moves_trigon + 1);
+    LIBBOARDGAME_CHECK_EQUAL(BoardConst::get(Variant::gembloq).get_range(),
+                             Move::onboard_moves_gembloq + 1);
+}
+
+/** Test that instances loaded from a cache file have the same tables as
+    computed instances and that cache files with a different version or
+    move range are ignored. */
+LIBBOARDGAME_TEST_CASE(pentobi_base_board_const_cache)
+{
+    auto variant = Variant::duo;
+    const string file = "./boardconst-"
+            + to_string(static_cast<int>(get_board_type(variant))) + "-"
+            + to_string(static_cast<int>(get_piece_set(variant))) + ".dat";
+    remove(file.c_str());
+    BoardConst::set_cache_dir(".");
+    auto bc = BoardConst::create(variant);
+    auto check_equal = [&](const BoardConst& loaded)
+    {
+        LIBBOARDGAME_CHECK_EQUAL(loaded.get_range(), bc->get_range());
+        LIBBOARDGAME_CHECK(memcmp(&loaded.get_precomp_moves(),
+                                  &bc->get_precomp_moves(),
+                                  sizeof(PrecompMoves)) == 0);
+        for (Move::IntType i = 1; i < bc->get_range(); ++i)
+        {
+            Move mv(i);
+            LIBBOARDGAME_CHECK(loaded.get_move_piece(mv)
+                               == bc->get_move_piece(mv));
+            auto points = bc->get_move_points(mv);
+            auto loaded_points = loaded.get_move_points(mv);
+            LIBBOARDGAME_CHECK(equal(loaded_points.begin(),
+                                     loaded_points.end(), points.begin(),
+                                     points.end()));
+            LIBBOARDGAME_CHECK(memcmp(&loaded.get_move_info_ext_2(mv),
+                                      &bc->get_move_info_ext_2(mv),
+                                      sizeof(MoveInfoExt2)) == 0);
+        }
+    };
+    check_equal(*BoardConst::create(variant));
+    // Offsets of the version and the move range in the header
+    for (streamoff offset : { 8, 24 })
+    {
+        uint32_t val;
+        {
+            fstream io(file, ios::in | ios::out | ios::binary);
+            io.seekg(offset);
+            io.read(reinterpret_cast<char*>(&val), sizeof(val));
+            uint32_t changed = val + 1;
+            io.seekp(offset);
+            io.write(reinterpret_cast<const char*>(&changed),
+                     sizeof(changed));
+        }
+        check_equal(*BoardConst::create(variant));
+        // The ignored file was replaced by a new one
+        uint32_t new_val = 0;
+        ifstream in(file, ios::binary);
+        in.seekg(offset);
+        in.read(reinterpret_cast<char*>(&new_val), sizeof(new_val));
+        LIBBOARDGAME_CHECK_EQUAL(new_val, val);
+    }
+    BoardConst::set_cache_dir("");
+    remove(file.c_str());
+}
+
 /** Check symmetry information in MoveInfoExt for some moves. */
 LIBBOARDGAME_TEST_CASE(pentobi_base_board_const_symmetry_info)
 {
@@ -161,4 +161,28 @@ LIBBOARDGAME_TEST_CASE(pentobi_base_board_get_place)
     LIBBOARDGAME_CHECK(! isPlaceShared);
 }
 
+/** Test that get_hash() does not depend on the move order and is restored
+    by restore_snapshot(). */
+LIBBOARDGAME_TEST_CASE(pentobi_base_board_hash)
+{
+    auto bd1 = make_unique<Board>(Variant::duo);
+    auto bd2 = make_unique<Board>(Variant::duo);
+    LIBBOARDGAME_CHECK_EQUAL(bd1->get_hash(), bd2->get_hash());
+    bd1->take_snapshot();
+    auto hash = bd1->get_hash();
+    play(*bd1, Color(0), "e10,f10");
+    play(*bd1, Color(1), "j5,j4");
+    play(*bd1, Color(0), "g9,h9,i9");
+    play(*bd2, Color(0), "g9,h9,i9");
+    play(*bd2, Color(1), "j5,j4");
+    LIBBOARDGAME_CHECK(bd1->get_hash() != bd2->get_hash());
+    bd2->set_to_play(Color(0));
+    play(*bd2, Color(0), "e10,f10");
+    LIBBOARDGAME_CHECK_EQUAL(bd1->get_hash(), bd2->get_hash());
+    bd2->set_to_play(Color(0));
+    LIBBOARDGAME_CHECK(bd1->get_hash() != bd2->get_hash());
+    bd1->restore_snapshot();
+    LIBBOARDGAME_CHECK_EQUAL(bd1->get_hash(), hash);
+}
+
 //-----------------------------------------------------------------------------
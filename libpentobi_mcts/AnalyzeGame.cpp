@@ -7,29 +7,86 @@
 #include "AnalyzeGame.h"
 
 #include "Search.h"
+#include "Util.h"
 #include "libboardgame_base/Log.h"
+#include "libboardgame_base/ThreadPool.h"
 #include "libboardgame_base/WallTimeSource.h"
 
 namespace libpentobi_mcts {
 
 using libboardgame_base::SgfError;
+using libboardgame_base::SgfNode;
+using libboardgame_base::TaskGroup;
 using libboardgame_base::WallTimeSource;
 using libpentobi_base::BoardUpdater;
+using libpentobi_base::Zobrist;
 
 //-----------------------------------------------------------------------------
 
+namespace {
+
+/** Position analyzed in AnalyzeGame::run_parallel(). */
+struct AnalyzePosition
+{
+    /** Node of the position. */
+    const SgfNode* node;
+
+    /** Color to play in the position. */
+    Color to_play;
+
+    /** Move stored in the analysis for the position. */
+    ColorMove mv;
+};
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+void AnalyzeGame::abort()
+{
+    m_abort = true;
+    lock_guard lock(m_mutex);
+    for (auto search : m_searches)
+        search->abort();
+}
+
 void AnalyzeGame::clear()
 {
     m_moves.clear();
     m_values.clear();
 }
 
+/** Get the key of a position in the cache.
+    Uses the hash of the board with c as the color to play, because
+    run() does not always search positions with the color to play of the
+    board. */
+uint_least64_t AnalyzeGame::get_cache_key(const Board& bd, Color c)
+{
+    return bd.get_hash() ^ Zobrist::get_to_play_key(bd.get_to_play())
+            ^ Zobrist::get_to_play_key(c);
+}
+
+void AnalyzeGame::init_cache(size_t nu_simulations)
+{
+    // Limit the memory used by the cache. 100000 positions are enough for
+    // many analyses of games with 100 moves.
+    if (m_variant != m_cache_variant
+            || nu_simulations != m_cache_nu_simulations
+            || m_cache.size() > 100000)
+    {
+        m_cache.clear();
+        m_cache_variant = m_variant;
+        m_cache_nu_simulations = nu_simulations;
+    }
+}
+
 void AnalyzeGame::run(const Game& game, Search& search, size_t nu_simulations,
                       const function<void(unsigned,unsigned)>& progress_callback)
 {
     m_variant = game.get_variant();
     m_moves.clear();
     m_values.clear();
+    init_cache(nu_simulations);
     auto& tree = game.get_tree();
     unique_ptr<Board> bd(new Board(m_variant));
     BoardUpdater updater;
@@ -72,14 +129,23 @@ void AnalyzeGame::run(const Game& game, Search& search, size_t nu_simulations,
                 try
                 {
                     updater.update(*bd, tree, node->get_parent());
-                    LIBBOARDGAME_LOG("Analyzing move ", bd->get_nu_moves());
-                    search.search(dummy, *bd, mv.color, max_count,
-                                  min_simulations, max_time, time_source);
-                    if (search.was_aborted())
-                        break;
+                    auto key = get_cache_key(*bd, mv.color);
+                    auto i = m_cache.find(key);
+                    if (i == m_cache.end())
+                    {
+                        LIBBOARDGAME_LOG("Analyzing move ",
+                                         bd->get_nu_moves());
+                        search.search(dummy, *bd, mv.color, max_count,
+                                      min_simulations, max_time,
+                                      time_source);
+                        if (search.was_aborted())
+                            break;
+                        i = m_cache.emplace(
+                                key, static_cast<double>(
+                                    search.get_root_val().get_mean())).first;
+                    }
                     m_moves.push_back(mv);
-                    m_values.push_back(static_cast<double>(
-                                           search.get_root_val().get_mean()));
+                    m_values.push_back(i->second);
                 }
                 catch (const SgfError&)
                 {
@@ -100,19 +166,209 @@ void AnalyzeGame::run(const Game& game, Search& search, size_t nu_simulations,
                 c = m_moves.back().color;
             else
                 c = bd->get_effective_to_play();
-            search.search(dummy, *bd, c, max_count, min_simulations, max_time,
-                          time_source);
-            if (search.was_aborted())
-                break;
+            auto key = get_cache_key(*bd, c);
+            auto i = m_cache.find(key);
+            if (i == m_cache.end())
+            {
+                search.search(dummy, *bd, c, max_count, min_simulations,
+                              max_time, time_source);
+                if (search.was_aborted())
+                    break;
+                i = m_cache.emplace(
+                        key, static_cast<double>(
+                            search.get_root_val().get_mean())).first;
+            }
             m_moves.emplace_back(c, Move::null());
-            m_values.push_back(static_cast<double>(
-                                   search.get_root_val().get_mean()));
+            m_values.push_back(i->second);
         }
         node = node->get_first_child_or_null();
     }
     while (node != nullptr);
 }
 
+void AnalyzeGame::run_parallel(const Game& game, unsigned nu_threads,
+                               size_t memory, size_t nu_simulations,
+                               const function<void(unsigned,unsigned)>&
+                               progress_callback)
+{
+    m_variant = game.get_variant();
+    m_moves.clear();
+    m_values.clear();
+    m_abort = false;
+    init_cache(nu_simulations);
+    auto& tree = game.get_tree();
+    auto& root = game.get_root();
+    auto tie_value = Search::SearchParamConst::tie_value;
+    // Collect the positions in the same order as in run(). Unlike in run(),
+    // the last position is computed in advance because its color to play
+    // depends on the board
+    vector<AnalyzePosition> positions;
+    unsigned total_moves = 0;
+    unsigned nu_analyzed = 0;
+    Color last_color(0);
+    auto node = &root;
+    do
+    {
+        auto mv = tree.get_move(*node);
+        if (! mv.is_null())
+        {
+            ++total_moves;
+            last_color = mv.color;
+            if (! node->has_parent())
+            {
+                // Root shouldn't contain moves in SGF files
+                m_moves.push_back(mv);
+                m_values.push_back(static_cast<double>(tie_value));
+                ++nu_analyzed;
+            }
+            else
+                positions.push_back({&node->get_parent(), mv.color, mv});
+        }
+        if (! node->has_children())
+        {
+            auto bd = make_unique<Board>(m_variant);
+            BoardUpdater updater;
+            try
+            {
+                updater.update(*bd, tree, *node);
+                Color c;
+                if (bd->is_game_over() && total_moves > 0)
+                    // See comment in run()
+                    c = last_color;
+                else
+                    c = bd->get_effective_to_play();
+                positions.push_back({node, c, ColorMove(c, Move::null())});
+            }
+            catch (const SgfError&)
+            {
+            }
+        }
+        node = node->get_first_child_or_null();
+    }
+    while (node != nullptr);
+    if (nu_threads == 0)
+        nu_threads = get_nu_threads();
+    nu_threads = static_cast<unsigned>(
+                max(min(size_t(nu_threads), positions.size()), size_t(1)));
+
+    // The searches are created in this thread and added to m_searches
+    // before the workers start, so that abort() reaches all of them
+    vector<unique_ptr<Search>> searches;
+    vector<unique_ptr<Board>> boards;
+    for (unsigned i = 0; i < nu_threads; ++i)
+    {
+        searches.push_back(make_unique<Search>(m_variant, 1,
+                                               memory / nu_threads));
+        boards.push_back(make_unique<Board>(m_variant));
+    }
+    {
+        lock_guard lock(m_mutex);
+        for (auto& search : searches)
+            m_searches.push_back(search.get());
+    }
+    progress_callback(nu_analyzed, total_moves);
+
+    enum class Status : char { pending, finished, failed };
+    vector<Status> status(positions.size(), Status::pending);
+    vector<double> values(positions.size());
+    atomic<size_t> next_position(0);
+    // Index of the first position not yet added to m_moves
+    size_t nu_added = 0;
+    atomic<bool> failed(false);
+    // Protects the results and m_cache and serializes the calls of
+    // progress_callback. Not m_mutex, because progress_callback might wait
+    // for a thread that calls abort()
+    mutex result_mutex;
+    const auto max_count = Float(nu_simulations);
+    size_t min_simulations = min(size_t(100), nu_simulations);
+    auto analyze = [&](Search& search, Board& bd)
+    {
+        WallTimeSource time_source;
+        BoardUpdater updater;
+        Move dummy;
+        // search() clears the abort flag when it starts, so an abort() that
+        // occurs while a search is starting is handled in the callback
+        search.set_callback([&](double, double) {
+            if (m_abort)
+                search.abort();
+        });
+        while (! m_abort && ! failed)
+        {
+            auto i = next_position.fetch_add(1);
+            if (i >= positions.size())
+                break;
+            auto& pos = positions[i];
+            auto result = Status::failed;
+            uint_least64_t key = 0;
+            bool is_cached = false;
+            try
+            {
+                updater.update(bd, tree, *pos.node);
+                key = get_cache_key(bd, pos.to_play);
+                {
+                    lock_guard lock(result_mutex);
+                    auto j = m_cache.find(key);
+                    if (j != m_cache.end())
+                    {
+                        values[i] = j->second;
+                        is_cached = true;
+                        result = Status::finished;
+                    }
+                }
+                if (! is_cached)
+                {
+                    LIBBOARDGAME_LOG("Analyzing move ", bd.get_nu_moves());
+                    search.search(dummy, bd, pos.to_play, max_count,
+                                  min_simulations, 0, time_source);
+                    if (! search.was_aborted() && ! m_abort)
+                    {
+                        values[i] = static_cast<double>(
+                                        search.get_root_val().get_mean());
+                        result = Status::finished;
+                    }
+                }
+            }
+            catch (const SgfError&)
+            {
+            }
+            lock_guard lock(result_mutex);
+            if (result == Status::finished && ! is_cached)
+                m_cache.emplace(key, values[i]);
+            status[i] = result;
+            if (result == Status::failed)
+                // Positions after a failed position are not used
+                failed = true;
+            else
+                ++nu_analyzed;
+            while (nu_added < positions.size()
+                   && status[nu_added] == Status::finished)
+            {
+                m_moves.push_back(positions[nu_added].mv);
+                m_values.push_back(values[nu_added]);
+                ++nu_added;
+            }
+            progress_callback(min(nu_analyzed, total_moves), total_moves);
+        }
+    };
+    TaskGroup group;
+    for (unsigned i = 0; i < nu_threads; ++i)
+        group.run([&analyze, &search = *searches[i], &bd = *boards[i]] {
+            analyze(search, bd);
+        });
+    try
+    {
+        group.wait();
+    }
+    catch (...)
+    {
+        lock_guard lock(m_mutex);
+        m_searches.clear();
+        throw;
+    }
+    lock_guard lock(m_mutex);
+    m_searches.clear();
+}
+
 void AnalyzeGame::set(Variant variant, const vector<ColorMove>& moves,
                       const vector<double>& values)
 {
@@ -7,7 +7,10 @@
 #ifndef LIBPENTOBI_MCTS_ANALYZE_GAME_H
 #define LIBPENTOBI_MCTS_ANALYZE_GAME_H
 
+#include <atomic>
 #include <functional>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include "libpentobi_base/Game.h"
 
@@ -16,16 +19,23 @@ namespace libpentobi_mcts {
 class Search;
 
 using namespace std;
+using libpentobi_base::Board;
+using libpentobi_base::Color;
 using libpentobi_base::ColorMove;
 using libpentobi_base::Game;
 using libpentobi_base::Variant;
 
 //-----------------------------------------------------------------------------
 
-/** Evaluate each position in the main variation of a game. */
+/** Evaluate each position in the main variation of a game.
+    The values of analyzed positions are remembered, so if a game is
+    analyzed again after a change, only the positions that did not occur in
+    the previous analyses are searched. */
 class AnalyzeGame
 {
 public:
+    /** Clear the analysis.
+        Does not forget the values of analyzed positions. */
     void clear();
 
     /** Run the analysis.
@@ -40,6 +50,31 @@ public:
     void run(const Game& game, Search& search, size_t nu_simulations,
              const function<void(unsigned,unsigned)>& progress_callback);
 
+    /** Run the analysis with several positions analyzed concurrently.
+        Each position is analyzed by a single-threaded search. Many small
+        independent searches use the cores more efficiently than a single
+        search with many threads, but the tree of a position cannot be
+        reused for the next position.
+        The analysis can be aborted from a different thread with abort().
+        @param game
+        @param nu_threads The number of concurrent searches. If 0, the number
+        of threads suggested by libpentobi_mcts::get_nu_threads() is used.
+        @param memory The memory for the search trees, which is split equally
+        between the searches.
+        @param nu_simulations
+        @param progress_callback Function that will be called at the beginning
+        of the analysis and whenever the analysis of a position has finished.
+        Arguments: number moves analyzed so far, total number of moves. The
+        function is called from different threads but never concurrently. */
+    void run_parallel(const Game& game, unsigned nu_threads, size_t memory,
+                      size_t nu_simulations,
+                      const function<void(unsigned,unsigned)>&
+                      progress_callback);
+
+    /** Abort an analysis started with run_parallel().
+        Can be called from a different thread. */
+    void abort();
+
     Variant get_variant() const;
 
     unsigned get_nu_moves() const;
@@ -56,6 +91,27 @@ private:
     vector<ColorMove> m_moves;
 
     vector<double> m_values;
+
+    atomic<bool> m_abort{false};
+
+    /** Protects m_searches. */
+    mutex m_mutex;
+
+    /** Searches currently used by run_parallel(). */
+    vector<Search*> m_searches;
+
+    /** Values of analyzed positions.
+        The key is created with get_cache_key(). The values are only valid
+        for m_cache_variant and m_cache_nu_simulations. */
+    unordered_map<uint_least64_t, double> m_cache;
+
+    Variant m_cache_variant;
+
+    size_t m_cache_nu_simulations = 0;
+
+    static uint_least64_t get_cache_key(const Board& bd, Color c);
+
+    void init_cache(size_t nu_simulations);
 };
 
 
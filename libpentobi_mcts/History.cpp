@@ -6,11 +6,14 @@
 
 #include "History.h"
 
+#include <istream>
+#include <ostream>
 #include "libpentobi_base/BoardUtil.h"
 
 namespace libpentobi_mcts {
 
 using namespace std;
+using libpentobi_base::BoardConst;
 using libpentobi_base::get_current_position_as_setup;
 
 //----------------------------------------------------------------------------
@@ -68,6 +71,60 @@ bool History::is_followup(
     return true;
 }
 
+bool History::read(istream& in)
+{
+    bool is_valid;
+    if (! (in >> is_valid))
+        return false;
+    if (! is_valid)
+    {
+        clear();
+        return true;
+    }
+    string variant_id;
+    unsigned to_play;
+    size_t nu_moves;
+    Variant variant;
+    if (! (in >> variant_id >> to_play >> nu_moves)
+            || ! parse_variant_id(variant_id, variant))
+        return false;
+    auto nu_colors = get_nu_colors(variant);
+    auto range = BoardConst::get(variant).get_range();
+    if (to_play >= nu_colors || nu_moves > Board::max_moves)
+        return false;
+    ArrayList<ColorMove, Board::max_moves> moves;
+    for (size_t i = 0; i < nu_moves; ++i)
+    {
+        unsigned c;
+        unsigned mv;
+        if (! (in >> c >> mv) || c >= nu_colors || mv >= range)
+            return false;
+        moves.push_back(ColorMove(Color(static_cast<Color::IntType>(c)),
+                                  Move(static_cast<Move::IntType>(mv))));
+    }
+    m_is_valid = true;
+    m_variant = variant;
+    m_nu_colors = nu_colors;
+    m_moves = moves;
+    m_to_play = Color(static_cast<Color::IntType>(to_play));
+    return true;
+}
+
+void History::write(ostream& out) const
+{
+    out << m_is_valid;
+    if (m_is_valid)
+    {
+        out << ' ' << to_string_id(m_variant) << ' '
+            << static_cast<unsigned>(m_to_play.to_int()) << ' '
+            << m_moves.size();
+        for (auto& mv : m_moves)
+            out << ' ' << static_cast<unsigned>(mv.color.to_int()) << ' '
+                << static_cast<unsigned>(mv.move.to_int());
+    }
+    out << '\n';
+}
+
 //----------------------------------------------------------------------------
 
 } // namespace libpentobi_mcts
@@ -7,11 +7,13 @@
 #ifndef LIBPENTOBI_MCTS_HISTORY_H
 #define LIBPENTOBI_MCTS_HISTORY_H
 
+#include <iosfwd>
 #include "SearchParamConst.h"
 #include "libpentobi_base/Board.h"
 
 namespace libpentobi_mcts {
 
+using namespace std;
 using libboardgame_base::ArrayList;
 using libpentobi_base::Board;
 using libpentobi_base::Color;
@@ -65,6 +67,14 @@ public:
 
     Color get_to_play() const;
 
+    /** Write the state in a text format that can be read with read(). */
+    void write(ostream& out) const;
+
+    /** Read a state written with write().
+        @return @c false if the data is invalid. The state is unchanged in
+        this case. */
+    bool read(istream& in);
+
 private:
     bool m_is_valid;
 
@@ -10,11 +10,13 @@
 #include <iomanip>
 #include "libboardgame_base/CpuTimeSource.h"
 #include "libboardgame_base/Memory.h"
+#include "libboardgame_base/Timer.h"
 #include "libboardgame_base/WallTimeSource.h"
 
 namespace libpentobi_mcts {
 
 using libboardgame_base::CpuTimeSource;
+using libboardgame_base::Timer;
 using libboardgame_base::WallTimeSource;
 using libpentobi_base::BoardType;
 
@@ -108,6 +110,10 @@ Player::Player(Variant initial_variant, unsigned max_level,
       m_max_level(max_level),
       m_level(4),
       m_fixed_simulations(0),
+      m_fixed_time(0),
+      m_total_time(0),
+      m_increment(0),
+      m_time_left(0),
       m_search(initial_variant, nu_threads, get_memory(max_level)),
       m_book(initial_variant),
       m_time_source(new WallTimeSource)
@@ -153,7 +159,13 @@ Player::Player(Variant initial_variant, unsigned max_level,
     }
 }
 
-Move Player::genmove(const Board& bd, Color c)
+Player::~Player()
+{
+    stop_ponder();
+}
+
+/** Generate a move without updating the clock. */
+Move Player::find_move(const Board& bd, Color c)
 {
     m_resign = false;
     m_was_aborted = false;
@@ -179,10 +191,13 @@ Move Player::genmove(const Board& bd, Color c)
     }
     Float max_count = 0;
     double max_time = 0;
+    double max_factor = 0;
     if (m_fixed_simulations > 0)
         max_count = m_fixed_simulations;
     else if (m_fixed_time > 0)
         max_time = m_fixed_time;
+    else if (m_total_time > 0)
+        max_time = get_move_time(bd, c, max_factor);
     else
     {
         switch (board_type)
@@ -248,6 +263,7 @@ Move Player::genmove(const Board& bd, Color c)
         LIBBOARDGAME_LOG("MaxCnt ", fixed, setprecision(0), max_count);
     else
         LIBBOARDGAME_LOG("MaxTime ", max_time);
+    m_search.set_adaptive_time(max_factor);
     if (! m_search.search(mv, bd, c, max_count, 0, max_time, *m_time_source))
         return Move::null();
     m_was_aborted = m_search.was_aborted();
@@ -259,6 +275,54 @@ Move Player::genmove(const Board& bd, Color c)
     return mv;
 }
 
+Move Player::genmove(const Board& bd, Color c)
+{
+    stop_ponder();
+    Move mv;
+    if (m_total_time <= 0)
+        mv = find_move(bd, c);
+    else
+    {
+        Timer timer(*m_time_source);
+        mv = find_move(bd, c);
+        m_time_left = max(m_time_left - timer(), 0.) + m_increment;
+    }
+    if (m_ponder && ! mv.is_null() && ! m_resign)
+        start_ponder(bd, c, mv);
+    return mv;
+}
+
+/** Get the time limit for a move with time control.
+    @param bd
+    @param c
+    @param[out] max_factor The maximum factor for extending the time limit if
+    the search is unstable (see SearchBase::set_adaptive_time()). */
+double Player::get_move_time(const Board& bd, Color c,
+                             double& max_factor) const
+{
+    // Estimate the number of moves left from the pieces left. Usually, not
+    // all pieces can be played, but overestimating the number of moves
+    // saves time for the end of the game, which is no problem because the
+    // simulations become much faster in later moves.
+    auto colors_per_player =
+            double(bd.get_nu_colors()) / double(bd.get_nu_players());
+    auto moves_left =
+            max(0.7 * colors_per_player * double(bd.get_pieces_left(c).size()),
+                3.);
+    // Keep a reserve for delays not measured by our clock, e.g. the
+    // communication with the controller
+    auto time_left = 0.95 * m_time_left;
+    auto max_time = time_left / moves_left + 0.8 * m_increment;
+    auto hard_limit = 0.5 * time_left + 0.8 * m_increment;
+    if (max_time <= 0)
+    {
+        max_factor = 0;
+        return 0.01;
+    }
+    max_factor = max(min(3., hard_limit / max_time), 1.);
+    return max_time;
+}
+
 Rating Player::get_rating(Variant variant, unsigned level)
 {
     // The ratings are roughly based on Elo differences measured in self-play
@@ -355,6 +419,49 @@ bool Player::resign() const
     return m_resign;
 }
 
+void Player::set_ponder(bool enable)
+{
+    if (! enable)
+        stop_ponder();
+    m_ponder = enable;
+}
+
+/** Start pondering on the position after a generated move. */
+void Player::start_ponder(const Board& bd, Color c, Move mv)
+{
+    if (! m_ponder_bd || m_ponder_bd->get_variant() != bd.get_variant())
+        m_ponder_bd = make_unique<Board>(bd.get_variant());
+    m_ponder_bd->copy_from(bd);
+    m_ponder_bd->play(c, mv);
+    if (m_ponder_bd->is_game_over())
+        return;
+    auto to_play = m_ponder_bd->get_effective_to_play();
+    LIBBOARDGAME_LOG("Pondering");
+    m_search.set_adaptive_time(0);
+    m_ponder_finished = false;
+    m_ponder_thread = thread([this, to_play]
+    {
+        Move dummy;
+        m_search.search(dummy, *m_ponder_bd, to_play, 0, 0,
+                        numeric_limits<double>::max(), *m_time_source);
+        m_ponder_finished = true;
+    });
+}
+
+void Player::stop_ponder()
+{
+    if (! m_ponder_thread.joinable())
+        return;
+    // The search resets the abort flag when it starts, so an abort before
+    // the pondering thread has started the search could be lost
+    while (! m_ponder_finished)
+    {
+        m_search.abort();
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    m_ponder_thread.join();
+}
+
 void Player::use_cpu_time(bool enable)
 {
     if (enable)
@@ -7,6 +7,8 @@
 #ifndef LIBPENTOBI_MCTS_PLAYER_H
 #define LIBPENTOBI_MCTS_PLAYER_H
 
+#include <atomic>
+#include <thread>
 #include "Search.h"
 #include "libboardgame_base/Rating.h"
 #include "libpentobi_base/Book.h"
@@ -38,6 +40,11 @@ public:
     Player(Variant initial_variant, unsigned max_level, const string& books_dir,
            unsigned nu_threads = 0);
 
+    ~Player() override;
+
+    /** Generate a move.
+        Stops pondering first. If pondering is enabled, pondering on the
+        position after the generated move starts before returning. */
     Move genmove(const Board& bd, Color c) override;
 
     bool resign() const override;
@@ -57,6 +64,23 @@ public:
         (maximum) time per search independent of the playing level. */
     void set_fixed_time(double seconds);
 
+    /** Use a time control with a total time per game and an increment per
+        move.
+        If total_time is greater than zero, the time limit of each move is
+        derived from the time left on the clock and the estimated number of
+        moves left, and is adapted to the stability of the search (see
+        libboardgame_mcts::SearchBase::set_adaptive_time()). This overrides
+        the level. The time control is disabled by set_level(),
+        set_fixed_simulations() and set_fixed_time(). */
+    void set_time_control(double total_time, double increment);
+
+    double get_time_left() const;
+
+    /** Set the time left on the clock.
+        If not set by the caller, the time left is reduced by the time used
+        in genmove() and increased by the increment after each move. */
+    void set_time_left(double seconds);
+
     bool get_use_book() const;
 
     void set_use_book(bool enable);
@@ -65,6 +89,22 @@ public:
 
     void set_level(unsigned level);
 
+    bool get_ponder() const;
+
+    /** Enable pondering.
+        If enabled, the search continues in the position after a generated
+        move in a background thread until the next genmove() or
+        stop_ponder(). The next search reuses the subtree of the move played
+        by the opponent. While pondering, the search must not be used
+        otherwise, so the caller needs to call stop_ponder() before
+        accessing the search in any way.
+        The default value is false. */
+    void set_ponder(bool enable);
+
+    /** Stop pondering and wait until the pondering search has finished.
+        Does nothing if not pondering. */
+    void stop_ponder();
+
     /** Use CPU time instead of Wall time to measure time. */
     void use_cpu_time(bool enable);
 
@@ -118,16 +158,38 @@ private:
 
     double m_fixed_time;
 
+    double m_total_time;
+
+    double m_increment;
+
+    double m_time_left;
+
     Search m_search;
 
     Book m_book;
 
     unique_ptr<TimeSource> m_time_source;
 
+    bool m_ponder = false;
+
+    /** Has the pondering search finished? */
+    atomic<bool> m_ponder_finished{false};
+
+    /** Position of the pondering search. */
+    unique_ptr<Board> m_ponder_bd;
+
+    thread m_ponder_thread;
+
+
+    Move find_move(const Board& bd, Color c);
+
+    double get_move_time(const Board& bd, Color c, double& max_factor) const;
 
     void init_settings();
 
     bool load_book(const string& filepath);
+
+    void start_ponder(const Board& bd, Color c, Move mv);
 };
 
 inline Float Player::get_fixed_simulations() const
@@ -140,6 +202,11 @@ inline double Player::get_fixed_time() const
     return m_fixed_time;
 }
 
+inline double Player::get_time_left() const
+{
+    return m_time_left;
+}
+
 inline unsigned Player::get_level() const
 {
     return m_level;
@@ -150,6 +217,11 @@ inline Rating Player::get_rating(Variant variant) const
     return get_rating(variant, m_level);
 }
 
+inline bool Player::get_ponder() const
+{
+    return m_ponder;
+}
+
 inline Search& Player::get_search()
 {
     return m_search;
@@ -164,12 +236,14 @@ inline void Player::set_fixed_simulations(Float n)
 {
     m_fixed_simulations = n;
     m_fixed_time = 0;
+    m_total_time = 0;
 }
 
 inline void Player::set_fixed_time(double seconds)
 {
     m_fixed_time = seconds;
     m_fixed_simulations = 0;
+    m_total_time = 0;
 }
 
 inline void Player::set_level(unsigned level)
@@ -177,6 +251,21 @@ inline void Player::set_level(unsigned level)
     m_level = level;
     m_fixed_simulations = 0;
     m_fixed_time = 0;
+    m_total_time = 0;
+}
+
+inline void Player::set_time_control(double total_time, double increment)
+{
+    m_total_time = total_time;
+    m_increment = increment;
+    m_time_left = total_time;
+    m_fixed_simulations = 0;
+    m_fixed_time = 0;
+}
+
+inline void Player::set_time_left(double seconds)
+{
+    m_time_left = seconds;
 }
 
 inline void Player::set_use_book(bool enable)
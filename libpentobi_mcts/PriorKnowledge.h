@@ -43,7 +43,8 @@ class PriorKnowledge
 {
 public:
     using Node =
-        libboardgame_mcts::Node<Move, Float, SearchParamConst::multithread>;
+        libboardgame_mcts::Node<Move, Float, SearchParamConst::multithread,
+                                SearchParamConst::compact_node>;
 
     using Tree = libboardgame_mcts::Tree<Node>;
 
@@ -0,0 +1,211 @@
+//-----------------------------------------------------------------------------
+/** @file libpentobi_mcts/RootPrecompMoves.h
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#ifndef LIBPENTOBI_MCTS_ROOT_PRECOMP_MOVES_H
+#define LIBPENTOBI_MCTS_ROOT_PRECOMP_MOVES_H
+
+#include <vector>
+#include "libpentobi_base/Board.h"
+
+namespace libpentobi_mcts {
+
+using namespace std;
+using libpentobi_base::Board;
+using libpentobi_base::Geometry;
+using libpentobi_base::Grid;
+using libpentobi_base::Move;
+using libpentobi_base::Piece;
+using libpentobi_base::PieceMap;
+using libpentobi_base::Point;
+using libpentobi_base::PrecompMoves;
+
+//-----------------------------------------------------------------------------
+
+/** Precomputed moves of a color specialized to the root position of a
+    search.
+    Provides the same lookup as PrecompMoves but only stores the lists for
+    the points at which the color can still have moves at the root position
+    and for the pieces that the color has left. Unlike PrecompMoves, which
+    always fills the lists for all points and pieces, the memory touched
+    shrinks as the game progresses, which reduces the working set of the
+    playouts and the time for constructing the lists.
+    Lookups are only allowed for the pieces passed to init(). All lookups at
+    points not added with add_point() return empty lists. */
+class RootPrecompMoves
+{
+public:
+    using Range = PrecompMoves::Range;
+
+    static constexpr unsigned nu_adj_status = PrecompMoves::nu_adj_status;
+
+    /** The lists of all pieces at a point and adjacent status.
+        Faster than calling RootPrecompMoves::get_moves() for each piece,
+        because the location of the lists is computed only once. */
+    class PointLists
+    {
+    public:
+        PointLists(const PrecompMoves::CompressedRange* moves_range,
+                   const PieceMap<uint_least8_t>& piece_index,
+                   const Move* move_lists)
+            : m_moves_range(moves_range),
+              m_piece_index(piece_index),
+              m_move_lists(move_lists)
+        { }
+
+        Range get_moves(Piece piece) const
+        {
+            auto& range = get_range(piece);
+            auto begin = m_move_lists + range.begin();
+            return {begin, begin + range.size()};
+        }
+
+        bool has_moves(Piece piece) const
+        {
+            return ! get_range(piece).empty();
+        }
+
+    private:
+        const PrecompMoves::CompressedRange* m_moves_range;
+
+        const PieceMap<uint_least8_t>& m_piece_index;
+
+        const Move* m_move_lists;
+
+        const PrecompMoves::CompressedRange& get_range(Piece piece) const
+        {
+            LIBBOARDGAME_ASSERT(m_piece_index[piece] != no_piece_index);
+            return m_moves_range[m_piece_index[piece]];
+        }
+    };
+
+
+    /** Start a construction.
+        Removes all lists but keeps the allocated memory. */
+    void init(const Board::PiecesLeftList& pieces, const Geometry& geo);
+
+    /** Add a point with move lists during construction.
+        The lists of the point are empty until set with set_list_range(). */
+    void add_point(Point p);
+
+    /** Start adding moves to the end of the list storage during
+        construction.
+        @param max_size The maximum number of moves to add.
+        @return The storage for the moves. The number of moves actually
+        added must be passed to end_add_moves(). */
+    Move* begin_add_moves(unsigned max_size)
+    {
+        auto size = m_move_lists.size();
+        m_move_lists.resize(size + max_size);
+        return m_move_lists.data() + size;
+    }
+
+    void end_add_moves(unsigned max_size, unsigned size)
+    {
+        LIBBOARDGAME_ASSERT(size <= max_size);
+        m_move_lists.resize(m_move_lists.size() - max_size + size);
+    }
+
+    /** Get the number of moves in the list storage.
+        Can be used as the begin index of the next list during
+        construction. */
+    unsigned get_nu_moves() const
+    {
+        return static_cast<unsigned>(m_move_lists.size());
+    }
+
+    /** Store beginning and end of a local move list during construction.
+        @pre p was added with add_point() */
+    void set_list_range(Point p, unsigned adj_status, Piece piece,
+                        unsigned begin, unsigned size)
+    {
+        LIBBOARDGAME_ASSERT(m_point_offset[p] != 0);
+        m_moves_range[get_index(piece, p, adj_status)] =
+                PrecompMoves::CompressedRange(begin, size);
+    }
+
+    /** Get all moves of a piece at a point constrained by the forbidden
+        status of adjacent points. */
+    Range get_moves(Piece piece, Point p, unsigned adj_status = 0) const
+    {
+        auto& range = m_moves_range[get_index(piece, p, adj_status)];
+        auto begin = m_move_lists.data() + range.begin();
+        return {begin, begin + range.size()};
+    }
+
+    bool has_moves(Piece piece, Point p, unsigned adj_status) const
+    {
+        return ! m_moves_range[get_index(piece, p, adj_status)].empty();
+    }
+
+    PointLists get_lists(Point p, unsigned adj_status) const
+    {
+        LIBBOARDGAME_ASSERT(adj_status < nu_adj_status);
+        return {m_moves_range.data() + m_point_offset[p]
+                + adj_status * m_nu_pieces, m_piece_index,
+                m_move_lists.data()};
+    }
+
+private:
+    static constexpr uint_least8_t no_piece_index = 0xff;
+
+    unsigned m_nu_pieces;
+
+    /** Index of a piece in the list of pieces passed to init(). */
+    PieceMap<uint_least8_t> m_piece_index;
+
+    /** Offset of the lists of a point in m_moves_range.
+        Points without lists have offset 0, which refers to a block of empty
+        lists at the beginning of m_moves_range. */
+    Grid<uint_least32_t> m_point_offset;
+
+    /** Ranges of the move lists in m_move_lists indexed by point offset,
+        adjacent status and piece index. */
+    vector<PrecompMoves::CompressedRange> m_moves_range;
+
+    /** Storage for all move lists. */
+    vector<Move> m_move_lists;
+
+
+    unsigned get_index(Piece piece, Point p, unsigned adj_status) const
+    {
+        LIBBOARDGAME_ASSERT(m_piece_index[piece] != no_piece_index);
+        LIBBOARDGAME_ASSERT(adj_status < nu_adj_status);
+        return m_point_offset[p] + adj_status * m_nu_pieces
+                + m_piece_index[piece];
+    }
+};
+
+inline void RootPrecompMoves::add_point(Point p)
+{
+    LIBBOARDGAME_ASSERT(m_point_offset[p] == 0);
+    auto offset = m_moves_range.size();
+    m_point_offset[p] = static_cast<uint_least32_t>(offset);
+    m_moves_range.resize(offset + nu_adj_status * m_nu_pieces);
+}
+
+inline void RootPrecompMoves::init(const Board::PiecesLeftList& pieces,
+                                   const Geometry& geo)
+{
+    m_nu_pieces = pieces.size();
+    m_piece_index.fill(no_piece_index);
+    for (unsigned i = 0; i < pieces.size(); ++i)
+        m_piece_index[pieces[i]] = static_cast<uint_least8_t>(i);
+    m_point_offset.fill(0, geo);
+    m_moves_range.assign(nu_adj_status * m_nu_pieces,
+                         PrecompMoves::CompressedRange());
+    m_move_lists.clear();
+    // Reserve the maximum size once to avoid reallocations during the first
+    // construction. Only the used part of the memory is touched.
+    m_moves_range.reserve(Point::range_onboard * nu_adj_status
+                          * Piece::max_pieces);
+    m_move_lists.reserve(PrecompMoves::max_move_lists_sum_length);
+}
+
+//-----------------------------------------------------------------------------
+
+} // namespace libpentobi_mcts
+
+#endif // LIBPENTOBI_MCTS_ROOT_PRECOMP_MOVES_H
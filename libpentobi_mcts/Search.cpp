@@ -56,7 +56,20 @@ void Search::get_root_position(Variant& variant, Setup& setup) const
 
 void Search::on_start_search(bool is_followup)
 {
-    m_shared_const.init(is_followup);
+    m_shared_const.init(is_followup,
+                        [this](unsigned n, const function<void(unsigned)>& f) {
+                            parallel_for(n, f);
+                        });
+}
+
+void Search::read_followup_info(istream& in)
+{
+    History history;
+    if (! history.read(in))
+        throw runtime_error("invalid position in search tree file");
+    m_last_history = history;
+    if (history.is_valid())
+        m_to_play = history.get_to_play();
 }
 
 bool Search::search(Move& mv, const Board& bd, Color to_play,
@@ -169,6 +182,11 @@ string Search::get_info() const
     return s.str();
 }
 
+void Search::write_followup_info(ostream& out) const
+{
+    m_last_history.write(out);
+}
+
 //-----------------------------------------------------------------------------
 
 } // namespace libpentobi_mcts
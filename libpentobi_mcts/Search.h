@@ -55,6 +55,10 @@ public:
 
     string get_info() const override;
 
+    void write_followup_info(ostream& out) const override;
+
+    void read_followup_info(istream& in) override;
+
 
     /** @name Parameters */
     /** @{ */
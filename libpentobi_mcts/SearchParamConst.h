@@ -47,6 +47,12 @@ struct SearchParamConst
     static constexpr bool multithread = true;
 #endif
 
+#ifdef LIBBOARDGAME_MCTS_COMPACT_NODE
+    static constexpr bool compact_node = true;
+#else
+    static constexpr bool compact_node = false;
+#endif
+
     static constexpr bool rave = true;
 
     static constexpr bool rave_dist_weighting = true;
@@ -10,7 +10,6 @@ namespace libpentobi_mcts {
 
 using libpentobi_base::BoardConst;
 using libpentobi_base::BoardType;
-using libpentobi_base::Piece;
 using libpentobi_base::PieceSet;
 using libpentobi_base::ScoreType;
 
@@ -30,13 +29,6 @@ void filter_min_size(const BoardConst& bc, ScoreType min_size,
     }
 }
 
-/** Check if an adjacent status is a possible follow-up status for another
-    one. */
-inline bool is_followup_adj_status(unsigned status_new, unsigned status_old)
-{
-    return (status_new & status_old) == status_old;
-}
-
 /** Check if a point is a useless move for the 1-piece in Callisto.
     @return true if all neighbors are occupied, because the 1-piece doesn't
     contribute to the score and playing there neither enables own moves
@@ -204,7 +196,7 @@ SharedConst::SharedConst(const Color& to_play)
       avoid_symmetric_draw(true)
 { }
 
-void SharedConst::init(bool is_followup)
+void SharedConst::init(bool is_followup, const ParallelFor& parallel_for)
 {
     auto& bd = *board;
     auto& bc = bd.get_board_const();
@@ -216,72 +208,133 @@ void SharedConst::init(bool is_followup)
         if (bd.get_point_state(p).is_empty() && bc.has_adj_status_points(p))
             points.get_unchecked(n++) = p;
     points.resize(n);
-    for (Color c : bd.get_colors())
-    {
-        auto& precomp = precomp_moves[c];
-        auto& old_precomp = (is_followup ? precomp : bc.get_precomp_moves());
-        m_is_forbidden.set();
+    // The colors are independent, each uses only its own lists and
+    // temporary variables
+    if (parallel_for)
+        parallel_for(bd.get_nu_colors(), [&](unsigned i) {
+            init_precomp_moves(Color(static_cast<Color::IntType>(i)), points,
+                               is_followup);
+        });
+    else
+        for (Color c : bd.get_colors())
+            init_precomp_moves(c, points, is_followup);
 
-        // Don't use bd.get_pieces_left() because its ordering is not preserved
-        // during a game. The in-place construction requires that the loop
-        // iterates in the same order as during the last construction such that
-        // it doesn't overwrite elements it still needs to read.
-        Board::PiecesLeftList pieces;
-        for (Piece::IntType i = 0; i < bc.get_nu_pieces(); ++i)
-            if (bd.is_piece_left(c, Piece(i)))
-                pieces.push_back(Piece(i));
+    if (! is_followup)
+        init_pieces_considered();
+    if (bd.get_piece_set() == PieceSet::callisto)
+        init_one_piece_callisto(is_followup);
+}
 
-        for (Point p : points)
-            if (! bd.is_forbidden(p, c))
-            {
-                auto adj_status = bd.get_adj_status(p, c);
-                for (Piece piece : pieces)
-                {
-                    if (! old_precomp.has_moves(piece, p, adj_status))
-                        continue;
-                    for (Move mv : old_precomp.get_moves(piece, p, adj_status))
-                        if (m_is_forbidden[mv] && ! bd.is_forbidden(c, mv))
-                            m_is_forbidden.clear(mv);
-                }
-            }
-        if (! is_followup)
-            for (Point p : points)
-                if (! bd.is_forbidden(p, c))
-                {
-                    auto adj_status = bd.get_adj_status(p, c);
-                    for (unsigned i = 0; i < PrecompMoves::nu_adj_status; ++i)
-                        if (is_followup_adj_status(i, adj_status))
-                            for (auto piece : pieces)
-                                precomp.set_list_range(p, i, piece, 0, 0);
-                }
-        unsigned n = 0;
-        for (Point p : points)
+void SharedConst::init_precomp_moves(Color c, const PointList& points,
+                                     bool is_followup)
+{
+    if (is_followup)
+        init_precomp_moves(c, points, precomp_moves[c]);
+    else
+        init_precomp_moves(c, points,
+                           board->get_board_const().get_precomp_moves());
+    // The lists are constructed in the temporary storage, the swap keeps
+    // the memory of the old lists for the next construction
+    swap(precomp_moves[c], m_tmp[c].precomp_moves);
+}
+
+/** Construct the lists of a color in its temporary storage.
+    @param c The color.
+    @param points The empty points of the board with adjacent status points.
+    @param old_precomp The precomputed moves of the board constants or, for
+    follow-up positions, of the last initialization. */
+template<class PRECOMP>
+void SharedConst::init_precomp_moves(Color c, const PointList& points,
+                                     const PRECOMP& old_precomp)
+{
+    auto& bd = *board;
+    auto& bc = bd.get_board_const();
+    auto& tmp = m_tmp[c];
+    auto& precomp = tmp.precomp_moves;
+    auto& is_forbidden = tmp.is_forbidden;
+    is_forbidden.set();
+
+    // Use the ordering of the pieces in the board constants for the piece
+    // indices in the lists, not the ordering of bd.get_pieces_left()
+    Board::PiecesLeftList pieces;
+    for (Piece::IntType i = 0; i < bc.get_nu_pieces(); ++i)
+        if (bd.is_piece_left(c, Piece(i)))
+            pieces.push_back(Piece(i));
+
+    // A list at a follow-up adjacent status is a subset of the list at the
+    // current adjacent status, so a piece has no moves at a point in the
+    // search if it has no non-forbidden moves there now
+    static_assert(Piece::max_pieces <= 32);
+    for (Point p : points)
+    {
+        auto& pieces_with_moves = tmp.pieces_with_moves[p];
+        pieces_with_moves = 0;
+        if (bd.is_forbidden(p, c))
+            continue;
+        auto adj_status = bd.get_adj_status(p, c);
+        for (Piece piece : pieces)
         {
-            if (bd.is_forbidden(p, c))
+            if (! old_precomp.has_moves(piece, p, adj_status))
                 continue;
-            auto adj_status = bd.get_adj_status(p, c);
-            for (unsigned i = 0; i < PrecompMoves::nu_adj_status; ++i)
+            for (Move mv : old_precomp.get_moves(piece, p, adj_status))
             {
-                if (! is_followup_adj_status(i, adj_status))
-                    continue;
-                for (auto piece : pieces)
+                if (is_forbidden[mv])
                 {
-                    if (! old_precomp.has_moves(piece, p, i))
+                    if (bd.is_forbidden(c, mv))
                         continue;
-                    auto begin = n;
-                    for (auto& mv : old_precomp.get_moves(piece, p, i))
-                        if (! m_is_forbidden[mv])
-                            precomp.set_move(n++, mv);
-                    precomp.set_list_range(p, i, piece, begin, n - begin);
+                    is_forbidden.clear(mv);
                 }
+                pieces_with_moves |= (uint_least32_t(1) << piece.to_int());
             }
         }
     }
+    precomp.init(pieces, bd.get_geometry());
+    for (Point p : points)
+    {
+        auto pieces_with_moves = tmp.pieces_with_moves[p];
+        if (pieces_with_moves == 0)
+            continue;
+        precomp.add_point(p);
+        auto adj_status = bd.get_adj_status(p, c);
+        for (auto piece : pieces)
+            if ((pieces_with_moves & (uint_least32_t(1) << piece.to_int()))
+                    != 0)
+                init_precomp_moves(c, p, adj_status, piece, old_precomp);
+    }
+}
 
-    if (! is_followup)
-        init_pieces_considered();
-    if (bd.get_piece_set() == PieceSet::callisto)
-        init_one_piece_callisto(is_followup);
+/** Construct the lists of a piece at a point in the temporary storage of a
+    color.
+    Only the lists at the follow-up statuses of the current adjacent status
+    (the supersets of the current status) can be used during the search. */
+template<class PRECOMP>
+void SharedConst::init_precomp_moves(Color c, Point p, unsigned adj_status,
+                                     Piece piece, const PRECOMP& old_precomp)
+{
+    auto& precomp = m_tmp[c].precomp_moves;
+    auto& is_forbidden = m_tmp[c].is_forbidden;
+    auto offset = precomp.get_nu_moves();
+    const auto max_size =
+            PrecompMoves::nu_adj_status * PrecompMoves::max_list_size;
+    auto moves = precomp.begin_add_moves(max_size);
+    unsigned n = 0;
+    for (auto i = adj_status; i < PrecompMoves::nu_adj_status;
+         i = (i + 1) | adj_status)
+    {
+        if (! old_precomp.has_moves(piece, p, i))
+            continue;
+        auto begin = n;
+        // Branchless because in the middle game, whether a move is forbidden
+        // is not predictable
+        for (Move mv : old_precomp.get_moves(piece, p, i))
+        {
+            moves[n] = mv;
+            n += ! is_forbidden[mv];
+        }
+        if (n != begin)
+            precomp.set_list_range(p, i, piece, offset + begin, n - begin);
+    }
+    precomp.end_add_moves(max_size, n);
 }
 
 void SharedConst::init_one_piece_callisto(bool is_followup)
@@ -7,6 +7,8 @@
 #ifndef LIBPENTOBI_MCTS_SHARED_CONST_H
 #define LIBPENTOBI_MCTS_SHARED_CONST_H
 
+#include <functional>
+#include "RootPrecompMoves.h"
 #include "libpentobi_base/Board.h"
 #include "libpentobi_base/MoveMarker.h"
 
@@ -17,12 +19,13 @@ using libboardgame_base::ArrayList;
 using libpentobi_base::Board;
 using libpentobi_base::Color;
 using libpentobi_base::ColorMap;
+using libpentobi_base::Grid;
 using libpentobi_base::Move;
 using libpentobi_base::MoveMarker;
+using libpentobi_base::Piece;
 using libpentobi_base::PieceMap;
 using libpentobi_base::Point;
 using libpentobi_base::PointList;
-using libpentobi_base::PrecompMoves;
 
 //-----------------------------------------------------------------------------
 
@@ -32,7 +35,7 @@ class SharedConst
 public:
     /** Precomputed moves additionally constrained by moves that are
         non-forbidden at root position. */
-    ColorMap<PrecompMoves> precomp_moves;
+    ColorMap<RootPrecompMoves> precomp_moves;
 
     /** The game board.
         Contains the current position. */
@@ -73,14 +76,48 @@ public:
     ArrayList<Move, Point::range_onboard> one_piece_moves_callisto;
 
 
+    /** Function that calls a function for the indices 0 to n - 1, possibly
+        in parallel. */
+    using ParallelFor =
+        function<void(unsigned n, const function<void(unsigned)>& func)>;
+
+
     explicit SharedConst(const Color& to_play);
 
-    void init(bool is_followup);
+    /** Initialize for a search at the current position of board.
+        @param is_followup Whether the position is a follow-up position of
+        the last initialization.
+        @param parallel_for If not empty, used to construct the precomputed
+        moves of the colors in parallel. */
+    void init(bool is_followup, const ParallelFor& parallel_for = {});
 
 private:
-    /** Temporary variable used in init().
-        Reused for efficiency. */
-    MoveMarker m_is_forbidden;
+    /** Temporary variables used in init().
+        One per color, because the colors can be initialized in parallel. */
+    struct ColorTmp
+    {
+        MoveMarker is_forbidden;
+
+        /** Storage for constructing the precomputed moves.
+            Reused for efficiency. */
+        RootPrecompMoves precomp_moves;
+
+        /** Bitset of the pieces that have non-forbidden moves at a point. */
+        Grid<uint_least32_t> pieces_with_moves;
+    };
+
+    ColorMap<ColorTmp> m_tmp;
+
+    void init_precomp_moves(Color c, const PointList& points,
+                            bool is_followup);
+
+    template<class PRECOMP>
+    void init_precomp_moves(Color c, const PointList& points,
+                            const PRECOMP& old_precomp);
+
+    template<class PRECOMP>
+    void init_precomp_moves(Color c, Point p, unsigned adj_status,
+                            Piece piece, const PRECOMP& old_precomp);
 
     void init_one_piece_callisto(bool is_followup);
 
@@ -48,13 +48,13 @@ inline void State::add_moves(Point p, Color c,
 {
     auto& marker = m_marker[c];
     auto& playout_features = m_playout_features[c];
-    auto adj_status = m_bd.get_adj_status(p, c);
+    auto lists = get_lists(c, p, m_bd.get_adj_status(p, c));
     for (Piece piece : pieces)
     {
-        if (! has_moves(c, piece, p, adj_status))
+        if (! lists.has_moves(piece))
             continue;
         auto gamma_piece = m_gamma_piece[piece];
-        for (Move mv : get_moves(c, piece, p, adj_status))
+        for (Move mv : lists.get_moves(piece))
             if (! marker[mv]
                     && check_move<MAX_SIZE>(
                            mv, get_move_info<MAX_SIZE>(mv), gamma_piece, moves,
@@ -107,8 +107,12 @@ void State::add_starting_moves(Color c, const Board::PiecesLeftList& pieces,
     auto& is_forbidden = m_bd.is_forbidden(c);
     float total_gamma = 0;
     bool is_gembloq = (m_bd.get_piece_set() == PieceSet::gembloq);
+    // Not adjacent status 0, because the precomputed moves only contain
+    // lists for follow-up statuses of the root position, and the lists for
+    // the current status contain all non-forbidden moves anyway
+    auto lists = get_lists(c, p, m_bd.get_adj_status(p, c));
     for (Piece piece : pieces)
-        for (Move mv : get_moves(c, piece, p, 0))
+        for (Move mv : lists.get_moves(piece))
         {
             // In GembloQ, not all moves covering one starting point
             // (=quarter-square tringle) are legal.
@@ -737,12 +741,12 @@ void State::init_moves_without_gamma(Color c)
             {
                 if (is_forbidden[p])
                     continue;
-                auto adj_status = m_bd.get_adj_status(p, c);
+                auto lists = get_lists(c, p, m_bd.get_adj_status(p, c));
                 for (Piece piece : pieces)
                 {
-                    if (! has_moves(c, piece, p, adj_status))
+                    if (! lists.has_moves(piece))
                         continue;
-                    for (Move mv : get_moves(c, piece, p, adj_status))
+                    for (Move mv : lists.get_moves(piece))
                         if (! marker[mv]
                                 && check_forbidden<MAX_SIZE>(
                                     is_forbidden, mv, moves, nu_moves))
@@ -29,6 +29,7 @@ using libpentobi_base::Piece;
 using libpentobi_base::PieceInfo;
 using libpentobi_base::PieceSet;
 using libpentobi_base::Variant;
+using libpentobi_base::Zobrist;
 
 //-----------------------------------------------------------------------------
 
@@ -44,7 +45,8 @@ class State
 {
 public:
     using Node =
-        libboardgame_mcts::Node<Move, Float, SearchParamConst::multithread>;
+        libboardgame_mcts::Node<Move, Float, SearchParamConst::multithread,
+                                SearchParamConst::compact_node>;
 
     using Tree = libboardgame_mcts::Tree<Node>;
 
@@ -80,6 +82,12 @@ public:
     /** Get current player to play. */
     PlayerInt get_player() const;
 
+    /** Get a hash of the current position in the in-tree phase.
+        This is the hash of the board combined with the number of
+        consecutive passes. Used for the transposition table of the
+        search. */
+    uint_least64_t get_hash() const;
+
     void start_search();
 
     void start_simulation(size_t n);
@@ -243,10 +251,8 @@ private:
     template<unsigned MAX_ADJ_ATTACH>
     const MoveInfoExt<MAX_ADJ_ATTACH>& get_move_info_ext(Move mv) const;
 
-    PrecompMoves::Range get_moves(Color c, Piece piece, Point p,
-                                  unsigned adj_status) const;
-
-    bool has_moves(Color c, Piece piece, Point p, unsigned adj_status) const;
+    RootPrecompMoves::PointLists get_lists(Color c, Point p,
+                                           unsigned adj_status) const;
 
     const PieceMap<bool>& get_is_piece_considered(Color c) const;
 
@@ -386,10 +392,18 @@ inline const MoveInfoExt<MAX_ADJ_ATTACH>& State::get_move_info_ext(
                 mv, m_move_info_ext_array);
 }
 
-inline PrecompMoves::Range State::get_moves(Color c, Piece piece, Point p,
-                                            unsigned adj_status) const
+inline RootPrecompMoves::PointLists State::get_lists(
+        Color c, Point p, unsigned adj_status) const
+{
+    return m_shared_const.precomp_moves[c].get_lists(p, adj_status);
+}
+
+inline uint_least64_t State::get_hash() const
 {
-    return m_shared_const.precomp_moves[c].get_moves(piece, p, adj_status);
+    static_assert(Color::range < Zobrist::nu_extra_keys);
+    if (m_nu_passes == 0)
+        return m_bd.get_hash();
+    return m_bd.get_hash() ^ Zobrist::get_extra_key(m_nu_passes);
 }
 
 inline PlayerInt State::get_player() const
@@ -400,12 +414,6 @@ inline PlayerInt State::get_player() const
     return static_cast<PlayerInt>(player);
 }
 
-inline bool State::has_moves(Color c, Piece piece, Point p,
-                             unsigned adj_status) const
-{
-    return m_shared_const.precomp_moves[c].has_moves(piece, p, adj_status);
-}
-
 inline void State::play_in_tree(Move mv)
 {
     Color to_play = m_bd.get_to_play();
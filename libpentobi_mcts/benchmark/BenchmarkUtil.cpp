@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------------
+/** @file libpentobi_mcts/benchmark/BenchmarkUtil.cpp
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include "BenchmarkUtil.h"
+
+#include "libpentobi_base/MoveMarker.h"
+
+namespace libpentobi_mcts {
+
+using libboardgame_base::split;
+using libpentobi_base::MoveList;
+using libpentobi_base::MoveMarker;
+
+//-----------------------------------------------------------------------------
+
+vector<Position> create_positions(Variant variant,
+                                  const vector<unsigned>& nu_moves,
+                                  RandomGenerator& random)
+{
+    vector<Position> result;
+    auto marker = make_unique<MoveMarker>();
+    auto moves = make_unique<MoveList>();
+    auto large_moves = make_unique<MoveList>();
+    for (auto n : nu_moves)
+    {
+        auto bd = make_unique<Board>(variant);
+        while (bd->get_nu_moves() < n)
+        {
+            auto c = bd->get_effective_to_play();
+            bd->gen_moves(c, *marker, *moves);
+            marker->clear(*moves);
+            if (moves->empty())
+                break;
+            unsigned max_size = 0;
+            for (auto mv : *moves)
+                max_size = max(max_size,
+                               unsigned(bd->get_move_points(mv).size()));
+            large_moves->clear();
+            for (auto mv : *moves)
+                if (bd->get_move_points(mv).size() == max_size)
+                    large_moves->push_back(mv);
+            bd->play(c, (*large_moves)[random.generate()
+                                       % large_moves->size()]);
+        }
+        auto to_play = bd->get_effective_to_play();
+        if (! bd->has_moves(to_play))
+            continue;
+        result.push_back({move(bd), to_play});
+    }
+    return result;
+}
+
+vector<Variant> parse_variants(const string& s)
+{
+    vector<Variant> result;
+    for (auto& i : split(s, ','))
+    {
+        Variant variant;
+        if (! parse_variant_id(i, variant))
+            throw runtime_error("invalid game variant " + i);
+        result.push_back(variant);
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+
+} // namespace libpentobi_mcts
@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------------
+/** @file libpentobi_mcts/benchmark/BenchmarkUtil.h
+    Functions used by several benchmarks.
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#ifndef LIBPENTOBI_MCTS_BENCHMARK_BENCHMARK_UTIL_H
+#define LIBPENTOBI_MCTS_BENCHMARK_BENCHMARK_UTIL_H
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "libboardgame_base/RandomGenerator.h"
+#include "libboardgame_base/StringUtil.h"
+#include "libpentobi_base/Board.h"
+
+namespace libpentobi_mcts {
+
+using namespace std;
+using libboardgame_base::RandomGenerator;
+using libpentobi_base::Board;
+using libpentobi_base::Color;
+using libpentobi_base::Variant;
+
+//-----------------------------------------------------------------------------
+
+/** Position used in a benchmark. */
+struct Position
+{
+    unique_ptr<Board> bd;
+
+    /** The color to play. Has moves in the position. */
+    Color to_play;
+};
+
+/** Create positions by playing random moves from the start position.
+    Larger pieces are preferred to get positions that are more similar to
+    real games. The positions depend only on the state of the random
+    generator, so the same positions can be used in different runs.
+    Positions in which the color to play has no moves are skipped.
+    @param variant The game variant.
+    @param nu_moves The number of moves played for each position. */
+vector<Position> create_positions(Variant variant,
+                                  const vector<unsigned>& nu_moves,
+                                  RandomGenerator& random);
+
+/** Parse a comma-separated list. */
+template<typename T>
+vector<T> parse_list(const string& s)
+{
+    vector<T> result;
+    for (auto& i : libboardgame_base::split(s, ','))
+    {
+        T t;
+        if (! libboardgame_base::from_string(i, t))
+            throw runtime_error("invalid list element '" + i + "'");
+        result.push_back(t);
+    }
+    return result;
+}
+
+/** Parse a comma-separated list of game variant identifiers. */
+vector<Variant> parse_variants(const string& s);
+
+//-----------------------------------------------------------------------------
+
+} // namespace libpentobi_mcts
+
+#endif // LIBPENTOBI_MCTS_BENCHMARK_BENCHMARK_UTIL_H
@@ -0,0 +1,490 @@
+//-----------------------------------------------------------------------------
+/** @file libpentobi_mcts/benchmark/MoveGenBenchmark.cpp
+    Measure the speed of the move generation kernels.
+
+    Times Board::gen_moves(), Board::is_legal(), Board::play() followed by
+    Board::restore_snapshot(), Board::restore_snapshot() alone and the
+    playout loop of State (State::gen_playout_move() and
+    State::play_playout()) on fixed positions for one game variant of each
+    board type. The positions are created with the same random generator
+    as in benchmark_search, so they are the same in each run for a given
+    seed. Reports nanoseconds per operation and, if the hardware
+    performance counters are available (Linux only, see
+    /proc/sys/kernel/perf_event_paranoid), L1 data cache read misses and
+    last-level cache misses per operation.
+    Unlike the simulations per second of benchmark_search, the results do
+    not depend on the search and can be used to evaluate changes to
+    BoardConst, PrecompMoves or PlayoutFeatures directly.
+
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include "BenchmarkUtil.h"
+#include "libboardgame_base/Log.h"
+#include "libboardgame_base/Options.h"
+#include "libpentobi_base/MoveMarker.h"
+#include "libpentobi_mcts/State.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using libboardgame_base::Options;
+using libboardgame_base::RandomGenerator;
+using libpentobi_base::Color;
+using libpentobi_base::Move;
+using libpentobi_base::MoveList;
+using libpentobi_base::MoveMarker;
+using libpentobi_base::Variant;
+using libpentobi_mcts::create_positions;
+using libpentobi_mcts::parse_list;
+using libpentobi_mcts::parse_variants;
+using libpentobi_mcts::Position;
+using libpentobi_mcts::SharedConst;
+using libpentobi_mcts::State;
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+/** Hardware performance counters of the current thread.
+    Counters that cannot be opened (other platforms than Linux, not enough
+    permissions, virtual machines without performance monitoring unit) are
+    reported as unavailable. */
+class PerfCounters
+{
+public:
+    static constexpr unsigned nu_counters = 2;
+
+    using Values = array<double, nu_counters>;
+
+
+    PerfCounters();
+
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    static const char* get_name(unsigned i);
+
+    bool is_available(unsigned i) const { return m_fd[i] >= 0; }
+
+    void start();
+
+    /** Stop counting and add the counts since start() to values. */
+    void stop(Values& values);
+
+private:
+    array<int, nu_counters> m_fd;
+};
+
+PerfCounters::PerfCounters()
+{
+    m_fd.fill(-1);
+#ifdef __linux__
+    array<pair<uint32_t, uint64_t>, nu_counters> events = {{
+        { PERF_TYPE_HW_CACHE,
+          PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }
+    }};
+    for (unsigned i = 0; i < nu_counters; ++i)
+    {
+        perf_event_attr attr = {};
+        attr.size = sizeof(attr);
+        attr.type = events[i].first;
+        attr.config = events[i].second;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd[i] = static_cast<int>(
+                    syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (auto fd : m_fd)
+        if (fd >= 0)
+            close(fd);
+#endif
+}
+
+const char* PerfCounters::get_name(unsigned i)
+{
+    static const char* names[nu_counters] = { "L1dMiss/op", "LLCMiss/op" };
+    return names[i];
+}
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+    for (auto fd : m_fd)
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+}
+
+void PerfCounters::stop([[maybe_unused]] Values& values)
+{
+#ifdef __linux__
+    for (unsigned i = 0; i < nu_counters; ++i)
+        if (m_fd[i] >= 0)
+        {
+            ioctl(m_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t count;
+            if (read(m_fd[i], &count, sizeof(count)) == sizeof(count))
+                values[i] += double(count);
+        }
+#endif
+}
+
+/** Accumulated result of a kernel. */
+struct Measurement
+{
+    double time = 0;
+
+    size_t nu_ops = 0;
+
+    PerfCounters::Values counters = {};
+};
+
+/** Position with precomputed move lists for the kernels. */
+struct KernelPosition
+{
+    Position pos;
+
+    /** The legal moves of the color to play. */
+    vector<Move> legal_moves;
+
+    /** The legal moves and the same number of random moves that are mostly
+        illegal, in random order. */
+    vector<Move> is_legal_moves;
+};
+
+/** Sink for results of kernels that have no side effects. */
+volatile size_t sink;
+
+/** Run a kernel repeatedly until a minimum time has passed.
+    @param f Runs the kernel and returns the number of operations.
+    @param min_time The minimum time in seconds.
+    @param counters
+    @param[in,out] m The measurement to add the result to. */
+template<class F>
+void measure(F f, double min_time, PerfCounters& counters, Measurement& m)
+{
+    // Warm up caches and branch predictors
+    f();
+    size_t nu_ops = 0;
+    double time;
+    counters.start();
+    auto start = chrono::steady_clock::now();
+    do
+    {
+        nu_ops += f();
+        time = chrono::duration<double>(chrono::steady_clock::now()
+                                        - start).count();
+    }
+    while (time < min_time);
+    counters.stop(m.counters);
+    m.time += time;
+    m.nu_ops += nu_ops;
+}
+
+vector<KernelPosition> create_kernel_positions(
+        Variant variant, const vector<unsigned>& nu_moves,
+        RandomGenerator& random)
+{
+    vector<KernelPosition> result;
+    auto marker = make_unique<MoveMarker>();
+    auto moves = make_unique<MoveList>();
+    for (auto& pos : create_positions(variant, nu_moves, random))
+    {
+        KernelPosition kernel_pos;
+        auto& bd = *pos.bd;
+        bd.gen_moves(pos.to_play, *marker, *moves);
+        marker->clear(*moves);
+        kernel_pos.legal_moves.assign(moves->begin(), moves->end());
+        auto& is_legal_moves = kernel_pos.is_legal_moves;
+        is_legal_moves = kernel_pos.legal_moves;
+        auto range = bd.get_board_const().get_range();
+        for (size_t i = 0; i < moves->size(); ++i)
+            is_legal_moves.push_back(
+                        Move(static_cast<Move::IntType>(
+                                 1 + random.generate() % (range - 1))));
+        for (auto i = is_legal_moves.size(); i > 1; --i)
+            swap(is_legal_moves[i - 1],
+                 is_legal_moves[random.generate() % i]);
+        bd.take_snapshot();
+        kernel_pos.pos = move(pos);
+        result.push_back(move(kernel_pos));
+    }
+    return result;
+}
+
+Measurement run_gen_moves(const vector<KernelPosition>& positions,
+                          double min_time, PerfCounters& counters)
+{
+    Measurement m;
+    auto marker = make_unique<MoveMarker>();
+    auto moves = make_unique<MoveList>();
+    for (auto& kernel_pos : positions)
+    {
+        auto& bd = *kernel_pos.pos.bd;
+        auto c = kernel_pos.pos.to_play;
+        measure([&] {
+            bd.gen_moves(c, *marker, *moves);
+            marker->clear(*moves);
+            return size_t(1);
+        }, min_time, counters, m);
+    }
+    return m;
+}
+
+Measurement run_is_legal(const vector<KernelPosition>& positions,
+                         double min_time, PerfCounters& counters)
+{
+    Measurement m;
+    for (auto& kernel_pos : positions)
+    {
+        auto& bd = *kernel_pos.pos.bd;
+        auto c = kernel_pos.pos.to_play;
+        auto& moves = kernel_pos.is_legal_moves;
+        measure([&] {
+            size_t nu_legal = 0;
+            for (auto mv : moves)
+                nu_legal += bd.is_legal(c, mv);
+            sink = nu_legal;
+            return moves.size();
+        }, min_time, counters, m);
+    }
+    return m;
+}
+
+Measurement run_play(const vector<KernelPosition>& positions, double min_time,
+                     PerfCounters& counters)
+{
+    Measurement m;
+    for (auto& kernel_pos : positions)
+    {
+        auto& bd = *kernel_pos.pos.bd;
+        auto c = kernel_pos.pos.to_play;
+        auto& moves = kernel_pos.legal_moves;
+        measure([&] {
+            for (auto mv : moves)
+            {
+                bd.play(c, mv);
+                bd.restore_snapshot();
+            }
+            return moves.size();
+        }, min_time, counters, m);
+    }
+    return m;
+}
+
+Measurement run_restore_snapshot(const vector<KernelPosition>& positions,
+                                 double min_time, PerfCounters& counters)
+{
+    Measurement m;
+    for (auto& kernel_pos : positions)
+    {
+        auto& bd = *kernel_pos.pos.bd;
+        auto n = kernel_pos.legal_moves.size();
+        measure([&] {
+            for (size_t i = 0; i < n; ++i)
+                bd.restore_snapshot();
+            return n;
+        }, min_time, counters, m);
+    }
+    return m;
+}
+
+/** Measure the playout loop of State.
+    An operation is a playout move. The time includes State::start_simulation()
+    and State::finish_in_tree() at the start of each playout, but not the
+    evaluation at the end. The last good reply heuristic is used with empty
+    tables. */
+Measurement run_playout(Variant variant,
+                        const vector<KernelPosition>& positions,
+                        double min_time, PerfCounters& counters)
+{
+    Measurement m;
+    Color to_play(0);
+    auto shared_const = make_unique<SharedConst>(to_play);
+    auto state = make_unique<State>(variant, *shared_const);
+    auto lgr = make_unique<State::LastGoodReply>();
+    size_t n = 0;
+    for (auto& kernel_pos : positions)
+    {
+        auto& bd = *kernel_pos.pos.bd;
+        to_play = kernel_pos.pos.to_play;
+        shared_const->board = &bd;
+        shared_const->init(false);
+        state->start_search();
+        lgr->init(bd.get_nu_players());
+        measure([&] {
+            state->start_simulation(n++);
+            state->finish_in_tree();
+            size_t nu_moves = 0;
+            Move last = Move::null();
+            Move second_last = Move::null();
+            State::PlayerMove mv;
+            while (state->gen_playout_move(*lgr, last, second_last, mv))
+            {
+                state->play_playout(mv.move);
+                ++nu_moves;
+                second_last = last;
+                last = mv.move;
+            }
+            return nu_moves;
+        }, min_time, counters, m);
+    }
+    return m;
+}
+
+void print_result(Variant variant, const string& kernel, const Measurement& m,
+                  const PerfCounters& counters)
+{
+    auto nu_ops = double(max(m.nu_ops, size_t(1)));
+    cout << left << setw(11) << to_string_id(variant) << setw(17) << kernel
+         << right << fixed << setprecision(1)
+         << setw(10) << 1e9 * m.time / nu_ops;
+    for (unsigned i = 0; i < PerfCounters::nu_counters; ++i)
+    {
+        cout << setw(12);
+        if (counters.is_available(i))
+            cout << setprecision(3) << m.counters[i] / nu_ops;
+        else
+            cout << '-';
+    }
+    cout << endl;
+}
+
+void run_benchmark(Variant variant, const vector<string>& kernels,
+                   const vector<KernelPosition>& positions, double min_time,
+                   PerfCounters& counters)
+{
+    if (positions.empty())
+        return;
+    // The minimum time is per kernel and variant
+    min_time /= double(positions.size());
+    for (auto& kernel : kernels)
+    {
+        Measurement m;
+        if (kernel == "gen_moves")
+            m = run_gen_moves(positions, min_time, counters);
+        else if (kernel == "is_legal")
+            m = run_is_legal(positions, min_time, counters);
+        else if (kernel == "play")
+            m = run_play(positions, min_time, counters);
+        else if (kernel == "restore_snapshot")
+            m = run_restore_snapshot(positions, min_time, counters);
+        else
+        {
+            LIBBOARDGAME_ASSERT(kernel == "playout");
+            m = run_playout(variant, positions, min_time, counters);
+        }
+        print_result(variant, kernel, m, counters);
+    }
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    libboardgame_base::LogInitializer log_initializer;
+    try
+    {
+        vector<string> specs = {
+            "help|h",
+            "kernels:",
+            "moves:",
+            "seed:",
+            "time:",
+            "variants|g:",
+        };
+        Options opt(argc, argv, specs);
+        if (opt.contains("help"))
+        {
+            cout <<
+                "Usage: benchmark_movegen [options]\n"
+                "--kernels      comma-separated kernels (default gen_moves,\n"
+                "               is_legal,play,restore_snapshot,playout)\n"
+                "--moves        comma-separated number of moves played in\n"
+                "               the test positions (default 4,12,24,36)\n"
+                "--seed         random seed for creating positions\n"
+                "--time         minimum time per kernel and game variant\n"
+                "               in seconds (default 1)\n"
+                "--variants,-g  comma-separated game variants (default one\n"
+                "               per board type: classic,duo,trigon,\n"
+                "               trigon_3,nexos,callisto,callisto_2,\n"
+                "               callisto_3,gembloq,gembloq_2,gembloq_3)\n"
+                "\n"
+                "play is Board::play() followed by\n"
+                "Board::restore_snapshot(), playout is a playout move of\n"
+                "State. The number of operations per kernel call\n"
+                "depends on the legal moves in the positions, so only\n"
+                "results for the same positions are comparable.\n";
+            return 0;
+        }
+        auto kernels = libboardgame_base::split(
+                    opt.get("kernels",
+                            "gen_moves,is_legal,play,restore_snapshot,"
+                            "playout"), ',');
+        for (auto& kernel : kernels)
+            if (kernel != "gen_moves" && kernel != "is_legal"
+                    && kernel != "play" && kernel != "restore_snapshot"
+                    && kernel != "playout")
+                throw runtime_error("invalid kernel " + kernel);
+        auto nu_moves = parse_list<unsigned>(opt.get("moves", "4,12,24,36"));
+        auto seed = opt.get<RandomGenerator::ResultType>("seed", 1);
+        auto min_time = opt.get<double>("time", 1);
+        auto variants = parse_variants(
+                    opt.get("variants",
+                            "classic,duo,trigon,trigon_3,nexos,callisto,"
+                            "callisto_2,callisto_3,gembloq,gembloq_2,"
+                            "gembloq_3"));
+        libboardgame_base::disable_logging();
+        // Make the playouts deterministic
+        RandomGenerator::set_global_seed(seed);
+        PerfCounters counters;
+        cout << "Variant    Kernel               ns/op";
+        for (unsigned i = 0; i < PerfCounters::nu_counters; ++i)
+            cout << setw(12) << PerfCounters::get_name(i);
+        cout << endl;
+        RandomGenerator random;
+        for (auto variant : variants)
+        {
+            random.set_seed(seed);
+            auto positions = create_kernel_positions(variant, nu_moves,
+                                                     random);
+            run_benchmark(variant, kernels, positions, min_time, counters);
+        }
+    }
+    catch (const exception& e)
+    {
+        cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
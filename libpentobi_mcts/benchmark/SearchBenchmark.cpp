@@ -0,0 +1,284 @@
+//-----------------------------------------------------------------------------
+/** @file libpentobi_mcts/benchmark/SearchBenchmark.cpp
+    Measure how the multi-threaded search scales with the number of threads.
+
+    Runs searches on a fixed set of positions for each game variant and number
+    of threads and reports simulations per second, tree nodes per second,
+    average in-tree depth and the speedup relative to the first entry of the
+    threads list. As a proxy for the playing strength, the moves are compared
+    to the result of a longer reference search with the largest number of
+    threads: Agree is the percentage of positions in which the same move was
+    selected, Regret is the average difference between the value of the
+    best move and the value of the selected move in the reference search.
+    Real strength differences still need to be measured with twogtp.
+    The node size and the number of nodes that fit into the search memory
+    are printed first. Comparing builds with and without
+    LIBBOARDGAME_MCTS_COMPACT_NODE and a small --memory shows the effect of
+    the node layout on the node density and on Agree and Regret.
+
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include "BenchmarkUtil.h"
+#include "libboardgame_base/Log.h"
+#include "libboardgame_base/Options.h"
+#include "libboardgame_base/ThreadPool.h"
+#include "libboardgame_base/WallTimeSource.h"
+#include "libpentobi_mcts/Search.h"
+
+using namespace std;
+using libboardgame_base::Options;
+using libboardgame_base::RandomGenerator;
+using libboardgame_base::ThreadPool;
+using libboardgame_base::WallTimeSource;
+using libpentobi_base::Move;
+using libpentobi_base::Variant;
+using libpentobi_mcts::create_positions;
+using libpentobi_mcts::Float;
+using libpentobi_mcts::parse_list;
+using libpentobi_mcts::parse_variants;
+using libpentobi_mcts::Position;
+using libpentobi_mcts::Search;
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+struct Result
+{
+    Move mv;
+
+    size_t nu_simulations;
+
+    size_t nu_nodes;
+
+    double time;
+
+    double in_tree_len;
+};
+
+struct Reference
+{
+    Move mv;
+
+    vector<pair<Move, Float>> values;
+
+    Float get_value(Move mv) const;
+};
+
+Float Reference::get_value(Move mv) const
+{
+    for (auto& i : values)
+        if (i.first == mv)
+            return i.second;
+    return 0;
+}
+
+Result run_search(Search& search, const Position& pos, Float nu_simulations,
+                  double max_time)
+{
+    WallTimeSource time_source;
+    Result result;
+    search.search(result.mv, *pos.bd, pos.to_play, nu_simulations, 0,
+                  max_time, time_source);
+    result.nu_simulations = search.get_nu_simulations();
+    result.nu_nodes = search.get_tree().get_nu_nodes();
+    result.time = search.get_last_time();
+    result.in_tree_len = search.get_avg_in_tree_len();
+    return result;
+}
+
+void run_benchmark(Variant variant, const vector<unsigned>& threads,
+                   const vector<Position>& positions, Float nu_simulations,
+                   double max_time, double reference_factor, size_t memory,
+                   bool root_parallel, bool numa, bool huge_pages,
+                   bool transpositions, unsigned batch_size, bool pool)
+{
+    vector<Reference> references;
+    if (reference_factor > 0)
+    {
+        auto search = make_unique<Search>(variant, threads.back(), memory);
+        search->set_reuse_subtree(false);
+        for (auto& pos : positions)
+        {
+            auto result = run_search(*search, pos,
+                                     nu_simulations * Float(reference_factor),
+                                     max_time * reference_factor);
+            Reference reference;
+            reference.mv = result.mv;
+            for (auto& i : search->get_tree().get_root_children())
+                reference.values.emplace_back(i.get_move(), i.get_value());
+            references.push_back(move(reference));
+        }
+    }
+    double base_sim_per_sec = 0;
+    for (auto nu_threads : threads)
+    {
+        auto search = make_unique<Search>(variant, nu_threads, memory);
+        search->set_reuse_subtree(false);
+        search->set_root_parallel(root_parallel);
+        search->set_numa(numa);
+        search->set_huge_pages(huge_pages);
+        search->set_transpositions(transpositions);
+        search->set_batch_size(batch_size);
+        if (pool)
+            search->set_thread_pool(&ThreadPool::get_global());
+        double time = 0;
+        double nu_sim = 0;
+        double nu_nodes = 0;
+        double in_tree_len = 0;
+        unsigned nu_agree = 0;
+        double regret = 0;
+        for (unsigned i = 0; i < positions.size(); ++i)
+        {
+            auto result = run_search(*search, positions[i], nu_simulations,
+                                     max_time);
+            time += result.time;
+            nu_sim += double(result.nu_simulations);
+            nu_nodes += double(result.nu_nodes);
+            in_tree_len += result.in_tree_len;
+            if (! references.empty())
+            {
+                auto& reference = references[i];
+                if (result.mv == reference.mv)
+                    ++nu_agree;
+                regret += reference.get_value(reference.mv)
+                        - reference.get_value(result.mv);
+            }
+        }
+        if (time == 0)
+            time = numeric_limits<double>::min();
+        auto n = double(positions.size());
+        double sim_per_sec = nu_sim / time;
+        if (base_sim_per_sec == 0)
+            base_sim_per_sec = sim_per_sec;
+        cout << left << setw(10) << to_string_id(variant) << right
+             << setw(5) << nu_threads
+             << fixed << setprecision(0)
+             << setw(11) << sim_per_sec
+             << setw(11) << nu_nodes / time
+             << setprecision(2)
+             << setw(7) << in_tree_len / n
+             << setw(8) << sim_per_sec / base_sim_per_sec;
+        if (! references.empty())
+            cout << setprecision(1) << setw(7) << 100 * nu_agree / n
+                 << setprecision(3) << setw(8) << regret / n;
+        cout << endl;
+    }
+}
+
+vector<unsigned> get_default_threads()
+{
+    vector<unsigned> result;
+    unsigned max_threads = max(thread::hardware_concurrency(), 1u);
+    for (unsigned i = 1; i < max_threads; i *= 2)
+        result.push_back(i);
+    result.push_back(max_threads);
+    return result;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    libboardgame_base::LogInitializer log_initializer;
+    try
+    {
+        vector<string> specs = {
+            "batch:",
+            "help|h",
+            "huge-pages",
+            "memory:",
+            "moves:",
+            "numa",
+            "pool",
+            "reference:",
+            "root-parallel",
+            "seed:",
+            "simulations|n:",
+            "threads:",
+            "time:",
+            "transpositions",
+            "variants|g:",
+        };
+        Options opt(argc, argv, specs);
+        if (opt.contains("help"))
+        {
+            cout <<
+                "Usage: benchmark_search [options]\n"
+                "--batch        simulations in flight per thread (default 1)\n"
+                "--huge-pages   use huge pages for the search tree\n"
+                "--memory       memory per search in MB (default 512)\n"
+                "--moves        comma-separated number of moves played in\n"
+                "               the test positions (default 4,12,24)\n"
+                "--numa         pin threads and use NUMA-local memory\n"
+                "--pool         run the search threads in the global thread\n"
+                "               pool\n"
+                "--reference    length of reference search as multiple of\n"
+                "               normal search, 0 disables it (default 4)\n"
+                "--root-parallel  use root parallelization\n"
+                "--seed         random seed for creating positions\n"
+                "--simulations  simulations per search\n"
+                "--threads      comma-separated list of number of threads\n"
+                "--time         time per search if no number of simulations\n"
+                "               is given (default 2)\n"
+                "--transpositions  share children of transposed positions\n"
+                "--variants,-g  comma-separated game variants (default\n"
+                "               duo,classic,trigon,nexos,callisto,gembloq)\n";
+            return 0;
+        }
+        auto memory = opt.get<size_t>("memory", 512) * 1000000;
+        auto nu_moves =
+                parse_list<unsigned>(opt.get("moves", "4,12,24"));
+        auto reference_factor = opt.get<double>("reference", 4);
+        auto seed = opt.get<RandomGenerator::ResultType>("seed", 1);
+        auto nu_simulations = opt.get<Float>("simulations", 0);
+        double max_time = nu_simulations > 0 ? 0 : opt.get<double>("time", 2);
+        auto threads = opt.contains("threads") ?
+                    parse_list<unsigned>(opt.get("threads"))
+                  : get_default_threads();
+        if (threads.empty())
+            throw runtime_error("empty threads list");
+        auto batch_size = opt.get<unsigned>("batch", 1);
+        if (batch_size == 0)
+            throw runtime_error("batch size must be positive");
+        auto variants = parse_variants(
+                    opt.get("variants",
+                            "duo,classic,trigon,nexos,callisto,gembloq"));
+        libboardgame_base::disable_logging();
+        cout << "Node size: " << sizeof(Search::Node) << " bytes, "
+             << memory / sizeof(Search::Node) << " nodes per search"
+             << endl;
+        cout << "Variant   Thr      Sim/s      Nds/s     Dp Speedup";
+        if (reference_factor > 0)
+            cout << "  Agree  Regret";
+        cout << endl;
+        RandomGenerator random;
+        for (auto variant : variants)
+        {
+            random.set_seed(seed);
+            auto positions = create_positions(variant, nu_moves, random);
+            run_benchmark(variant, threads, positions, nu_simulations,
+                          max_time, reference_factor, memory,
+                          opt.contains("root-parallel"),
+                          opt.contains("numa"),
+                          opt.contains("huge-pages"),
+                          opt.contains("transpositions"),
+                          batch_size, opt.contains("pool"));
+        }
+    }
+    catch (const exception& e)
+    {
+        cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+//-----------------------------------------------------------------------------
+/** @file libpentobi_mcts/tests/AnalyzeGameTest.cpp
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include "libpentobi_mcts/AnalyzeGame.h"
+
+#include "libboardgame_base/TreeReader.h"
+#include "libpentobi_mcts/Search.h"
+#include "libboardgame_test/Test.h"
+
+using namespace std;
+using namespace libpentobi_mcts;
+using libboardgame_base::SgfNode;
+using libboardgame_base::TreeReader;
+using libpentobi_base::Move;
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+void read_game(Game& game, const string& sgf)
+{
+    istringstream in(sgf);
+    TreeReader reader;
+    reader.read(in);
+    unique_ptr<SgfNode> root = reader.get_tree_transfer_ownership();
+    game.init(root);
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+/** Test that analyzing a game again after changing the last move reuses
+    the values of the unchanged positions. */
+LIBBOARDGAME_TEST_CASE(pentobi_mcts_analyze_game_reuse_values)
+{
+    Game game(Variant::duo);
+    read_game(game, "(;GM[Blokus Duo];B[e8,d9,e9,f9,e10];W[j4,i5,j5,h6,i6]"
+              ";B[g7,f8,g8,h8])");
+    auto search = make_unique<Search>(Variant::duo, 1, 300000);
+    AnalyzeGame analyze_game;
+    analyze_game.run(game, *search, 100, [](unsigned, unsigned) { });
+    LIBBOARDGAME_CHECK_EQUAL(analyze_game.get_nu_moves(), 4u);
+    vector<double> values;
+    for (unsigned i = 0; i < 4; ++i)
+        values.push_back(analyze_game.get_value(i));
+    read_game(game, "(;GM[Blokus Duo];B[e8,d9,e9,f9,e10];W[j4,i5,j5,h6,i6]"
+              ";B[f7,f8,g8,h8])");
+    analyze_game.run(game, *search, 100, [](unsigned, unsigned) { });
+    LIBBOARDGAME_CHECK_EQUAL(analyze_game.get_nu_moves(), 4u);
+    for (unsigned i = 0; i < 3; ++i)
+        LIBBOARDGAME_CHECK_EQUAL(analyze_game.get_value(i), values[i]);
+}
+
+/** Test that the parallel analysis stores the moves in the order of the
+    main variation followed by the last position. */
+LIBBOARDGAME_TEST_CASE(pentobi_mcts_analyze_game_parallel)
+{
+    Game game(Variant::duo);
+    read_game(game, "(;GM[Blokus Duo];B[e8,d9,e9,f9,e10];W[j4,i5,j5,h6,i6]"
+              ";B[g7,f8,g8,h8];W[g4,f5,g5,h5])");
+    AnalyzeGame analyze_game;
+    unsigned nu_calls = 0;
+    analyze_game.run_parallel(game, 3, 300000, 50,
+                              [&](unsigned, unsigned total_moves) {
+        LIBBOARDGAME_CHECK_EQUAL(total_moves, 4u);
+        ++nu_calls;
+    });
+    LIBBOARDGAME_CHECK_EQUAL(nu_calls, 6u);
+    LIBBOARDGAME_CHECK_EQUAL(analyze_game.get_nu_moves(), 5u);
+    auto& tree = game.get_tree();
+    auto node = &tree.get_root();
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        node = &node->get_first_child();
+        LIBBOARDGAME_CHECK(analyze_game.get_move(i) == tree.get_move(*node));
+    }
+    LIBBOARDGAME_CHECK(analyze_game.get_move(4).move.is_null());
+    for (unsigned i = 0; i < 5; ++i)
+    {
+        LIBBOARDGAME_CHECK(analyze_game.get_value(i) >= 0);
+        LIBBOARDGAME_CHECK(analyze_game.get_value(i) <= 1);
+    }
+}
+
+//-----------------------------------------------------------------------------
@@ -65,6 +65,35 @@ LIBBOARDGAME_TEST_CASE(pentobi_mcts_search_no_large_pieces)
     LIBBOARDGAME_CHECK(! mv.is_null());
 }
 
+/** Test that load_tree() keeps the tree in memory allocated with the
+    huge pages setting of the search instead of using the mapping of the
+    file. */
+LIBBOARDGAME_TEST_CASE(pentobi_mcts_search_load_tree_huge_pages)
+{
+    auto bd = make_unique<Board>(Variant::duo);
+    unsigned nu_threads = 1;
+    size_t memory = 8000000;
+    auto search = make_unique<Search>(bd->get_variant(), nu_threads, memory);
+    search->set_huge_pages(true);
+    Float max_count = 100;
+    size_t min_simulations = 1;
+    double max_time = 0;
+    CpuTimeSource time_source;
+    Move mv;
+    search->search(mv, *bd, Color(0), max_count, min_simulations, max_time,
+                   time_source);
+    const string file = "pentobi_mcts_search_load_tree_huge_pages.tmp";
+    search->save_tree(file);
+    auto search2 = make_unique<Search>(bd->get_variant(), nu_threads, memory);
+    search2->set_huge_pages(true);
+    search2->load_tree(file);
+    remove(file.c_str());
+    LIBBOARDGAME_CHECK_EQUAL(search2->get_tree().get_page_size(),
+                             search->get_tree().get_page_size());
+    LIBBOARDGAME_CHECK_EQUAL(search2->get_tree().get_nu_nodes(),
+                             search->get_tree().get_nu_nodes());
+}
+
 /** Test that useless one-piece moves are generated if no other moves exist.
     Useless one-piece moves (all neighbors occupied) are not needed during
     the search, but the search should still return one if no other legal
@@ -0,0 +1,114 @@
+//-----------------------------------------------------------------------------
+/** @file libpentobi_mcts/tests/SharedConstTest.cpp
+    @author Markus Enzenberger
+    @copyright GNU General Public License version 3 or later */
+//-----------------------------------------------------------------------------
+
+#include "libpentobi_mcts/SharedConst.h"
+
+#include <thread>
+#include "libboardgame_base/SgfUtil.h"
+#include "libboardgame_base/TreeReader.h"
+#include "libboardgame_test/Test.h"
+#include "libpentobi_base/BoardUpdater.h"
+#include "libpentobi_base/PentobiTree.h"
+
+using namespace std;
+using namespace libpentobi_mcts;
+using libboardgame_base::SgfNode;
+using libboardgame_base::TreeReader;
+using libboardgame_base::get_last_node;
+using libpentobi_base::BoardUpdater;
+using libpentobi_base::PentobiTree;
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+/** Check that the precomputed moves of the shared constants contain the
+    non-forbidden moves of the precomputed moves of the board constants. */
+void check_precomp_moves(const SharedConst& shared_const, const Board& bd)
+{
+    auto& bc = bd.get_board_const();
+    for (Color c : bd.get_colors())
+        for (Point p : bd)
+        {
+            if (! bd.get_point_state(p).is_empty()
+                    || ! bc.has_adj_status_points(p) || bd.is_forbidden(p, c))
+                continue;
+            auto adj_status = bd.get_adj_status(p, c);
+            for (Piece piece : bd.get_pieces_left(c))
+            {
+                vector<Move> expected;
+                for (Move mv : bc.get_moves(piece, p, adj_status))
+                    if (! bd.is_forbidden(c, mv))
+                        expected.push_back(mv);
+                auto& precomp = shared_const.precomp_moves[c];
+                vector<Move> moves;
+                if (precomp.has_moves(piece, p, adj_status))
+                    for (Move mv : precomp.get_moves(piece, p, adj_status))
+                        moves.push_back(mv);
+                LIBBOARDGAME_CHECK(moves == expected);
+            }
+        }
+}
+
+/** Check the precomputed moves after initializations in a Trigon game.
+    @param parallel_for Passed to SharedConst::init() */
+void check_init(const SharedConst::ParallelFor& parallel_for)
+{
+    istringstream
+        in(R"delim(
+           (;GM[Blokus Trigon Two-Player];1[r4,r5,s5,r6,s6,r7]
+           ;2[r12,q13,r13,q14,r14,r15];3[k11,l11,m11,n11,j12,k12]
+           ;4[w7,x7,y7,z7,v8,w8];1[s8,t8,r9,s9,t9,u9]
+           ;2[n12,o12,m13,n13,o13,o14];3[k13,k14,l14,l15,m15,n15]
+           ;4[w9,t10,u10,v10,w10,x10];1[n10,o10,p10,q10,r10,r11]
+           ;2[o15,k16,l16,m16,n16,o16];3[i15,j15,h16,i16,j16,j17]
+           ;4[u11,s12,t12,u12,v12,v13];1[p4,m5,n5,o5,p5,m6]
+           ;2[k17,i18,j18,k18,l18,m18];3[l17,m17,n17,o17,p17,o18]
+           ;4[t14,u14,s15,t15,r16,s16];1[l8,m8,j9,k9,l9,m9])
+           )delim");
+    TreeReader reader;
+    reader.read(in);
+    unique_ptr<SgfNode> root = reader.get_tree_transfer_ownership();
+    PentobiTree tree(root);
+    auto bd = make_unique<Board>(tree.get_variant());
+    Color to_play(0);
+    auto shared_const = make_unique<SharedConst>(to_play);
+    shared_const->board = bd.get();
+    BoardUpdater updater;
+    auto node = &tree.get_root();
+    for (unsigned i = 0; i < 8; ++i)
+        node = &node->get_first_child();
+    updater.update(*bd, tree, *node);
+    shared_const->init(false, parallel_for);
+    check_precomp_moves(*shared_const, *bd);
+    // Follow-up position constructed from the lists of the last position
+    updater.update(*bd, tree, get_last_node(tree.get_root()));
+    shared_const->init(true, parallel_for);
+    check_precomp_moves(*shared_const, *bd);
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+LIBBOARDGAME_TEST_CASE(pentobi_mcts_shared_const_precomp_moves)
+{
+    check_init({});
+}
+
+/** Test that initializing the colors in parallel gives the same lists. */
+LIBBOARDGAME_TEST_CASE(pentobi_mcts_shared_const_precomp_moves_parallel)
+{
+    check_init([](unsigned n, const function<void(unsigned)>& func) {
+        vector<thread> threads;
+        for (unsigned i = 0; i < n; ++i)
+            threads.emplace_back(func, i);
+        for (auto& t : threads)
+            t.join();
+    });
+}
+
+//-----------------------------------------------------------------------------
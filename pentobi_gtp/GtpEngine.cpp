@@ -26,11 +26,15 @@ GtpEngine::GtpEngine(
     create_player(variant, level, books_dir, nu_threads);
     get_mcts_player().set_use_book(use_book);
     add("get_value", &GtpEngine::cmd_get_value);
+    add("load_search_tree", &GtpEngine::cmd_load_search_tree);
     add("name", &GtpEngine::cmd_name);
     add("param", &GtpEngine::cmd_param);
     add("move_values", &GtpEngine::cmd_move_values);
+    add("save_search_tree", &GtpEngine::cmd_save_search_tree);
     add("save_tree", &GtpEngine::cmd_save_tree);
     add("selfplay", &GtpEngine::cmd_selfplay);
+    add("time_control", &GtpEngine::cmd_time_control);
+    add("time_left", &GtpEngine::cmd_time_left);
     add("version", &GtpEngine::cmd_version);
 }
 
@@ -41,6 +45,18 @@ void GtpEngine::cmd_get_value(Response& response)
     response << get_search().get_tree().get_root().get_value();
 }
 
+void GtpEngine::cmd_load_search_tree(Arguments args)
+{
+    try
+    {
+        get_search().load_tree(args.get<string>());
+    }
+    catch (const runtime_error& e)
+    {
+        throw Failure(e.what());
+    }
+}
+
 void GtpEngine::cmd_move_values(Response& response)
 {
     auto children = get_search().get_tree().get_root_children();
@@ -65,6 +81,21 @@ void GtpEngine::cmd_name(Response& response)
     response.set("Pentobi");
 }
 
+void GtpEngine::cmd_save_search_tree(Arguments args)
+{
+    auto& search = get_search();
+    if (! search.get_last_history().is_valid())
+        throw Failure("no search tree");
+    try
+    {
+        search.save_tree(args.get<string>());
+    }
+    catch (const runtime_error& e)
+    {
+        throw Failure(e.what());
+    }
+}
+
 void GtpEngine::cmd_save_tree(Arguments args)
 {
     auto& search = get_search();
@@ -121,12 +152,17 @@ void GtpEngine::cmd_param(Arguments args, Response& response)
     if (args.get_size() == 0)
         response
             << "avoid_symmetric_draw " << s.get_avoid_symmetric_draw() << '\n'
+            << "batch_size " << s.get_batch_size() << '\n'
             << "exploration_constant " << s.get_exploration_constant() << '\n'
             << "fixed_simulations " << p.get_fixed_simulations() << '\n'
+            << "ponder " << p.get_ponder() << '\n'
             << "rave_child_max " << s.get_rave_child_max() << '\n'
             << "rave_parent_max " << s.get_rave_parent_max() << '\n'
             << "rave_weight " << s.get_rave_weight() << '\n'
             << "reuse_subtree " << s.get_reuse_subtree() << '\n'
+            << "reuse_tree " << s.get_reuse_tree() << '\n'
+            << "root_parallel " << s.get_root_parallel() << '\n'
+            << "transpositions " << s.get_transpositions() << '\n'
             << "use_book " << p.get_use_book() << '\n';
     else
     {
@@ -134,10 +170,14 @@ void GtpEngine::cmd_param(Arguments args, Response& response)
         auto name = args.get(0);
         if (name == "avoid_symmetric_draw")
             s.set_avoid_symmetric_draw(args.get<bool>(1));
+        else if (name == "batch_size")
+            s.set_batch_size(args.get_min<unsigned>(1, 1));
         else if (name == "exploration_constant")
             s.set_exploration_constant(args.get<Float>(1));
         else if (name == "fixed_simulations")
             p.set_fixed_simulations(args.get<Float>(1));
+        else if (name == "ponder")
+            p.set_ponder(args.get<bool>(1));
         else if (name == "rave_child_max")
             s.set_rave_child_max(args.get<Float>(1));
         else if (name == "rave_parent_max")
@@ -146,6 +186,12 @@ void GtpEngine::cmd_param(Arguments args, Response& response)
             s.set_rave_weight(args.get<Float>(1));
         else if (name == "reuse_subtree")
             s.set_reuse_subtree(args.get<bool>(1));
+        else if (name == "reuse_tree")
+            s.set_reuse_tree(args.get<bool>(1));
+        else if (name == "root_parallel")
+            s.set_root_parallel(args.get<bool>(1));
+        else if (name == "transpositions")
+            s.set_transpositions(args.get<bool>(1));
         else if (name == "use_book")
             p.set_use_book(args.get<bool>(1));
         else
@@ -157,6 +203,24 @@ void GtpEngine::cmd_param(Arguments args, Response& response)
     }
 }
 
+void GtpEngine::cmd_time_control(Arguments args)
+{
+    args.check_size(2);
+    get_mcts_player().set_time_control(args.get_min<double>(0, 0),
+                                       args.get_min<double>(1, 0));
+}
+
+/** Set the time left on the clock of the engine.
+    The engine uses a single clock, so the color argument is only checked for
+    validity. The number of stones is ignored because the time control does
+    not use byo-yomi periods. */
+void GtpEngine::cmd_time_left(Arguments args)
+{
+    args.check_size(3);
+    get_color_arg(args, 0);
+    get_mcts_player().set_time_left(args.get_min<double>(1, 0));
+}
+
 void GtpEngine::cmd_version(Response& response)
 {
     string version;
@@ -197,9 +261,27 @@ Search& GtpEngine::get_search()
     return get_mcts_player().get_search();
 }
 
+/** Stop pondering before handling a command.
+    Any command might change the position or access the search. */
+void GtpEngine::on_handle_cmd_begin()
+{
+    get_mcts_player().stop_ponder();
+    libpentobi_gtp::GtpEngine::on_handle_cmd_begin();
+}
+
 void GtpEngine::use_cpu_time(bool enable)
 {
     get_mcts_player().use_cpu_time(enable);
 }
 
+void GtpEngine::use_huge_pages(bool enable)
+{
+    get_search().set_huge_pages(enable);
+}
+
+void GtpEngine::use_numa(bool enable)
+{
+    get_search().set_numa(enable);
+}
+
 //-----------------------------------------------------------------------------
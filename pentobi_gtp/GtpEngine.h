@@ -32,10 +32,14 @@ public:
 
     void cmd_param(Arguments args, Response& response);
     void cmd_get_value(Response& response);
+    void cmd_load_search_tree(Arguments args);
     void cmd_move_values(Response& response);
     void cmd_name(Response& response);
     void cmd_selfplay(Arguments args);
+    void cmd_save_search_tree(Arguments args);
     void cmd_save_tree(Arguments args);
+    void cmd_time_control(Arguments args);
+    void cmd_time_left(Arguments args);
     void cmd_version(Response& response);
 
     Player& get_mcts_player();
@@ -43,6 +47,15 @@ public:
     /** @see Player::use_cpu_time() */
     void use_cpu_time(bool enable);
 
+    /** @see libboardgame_mcts::SearchBase::set_huge_pages() */
+    void use_huge_pages(bool enable);
+
+    /** @see libboardgame_mcts::SearchBase::set_numa() */
+    void use_numa(bool enable);
+
+protected:
+    void on_handle_cmd_begin() override;
+
 private:
     unique_ptr<PlayerBase> m_player;
 
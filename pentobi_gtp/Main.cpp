@@ -16,6 +16,7 @@ using libboardgame_base::RandomGenerator;
 using libboardgame_gtp::Failure;
 using libpentobi_base::parse_variant_id;
 using libpentobi_base::Board;
+using libpentobi_base::BoardConst;
 using libpentobi_base::Variant;
 using libpentobi_mcts::Player;
 
@@ -50,14 +51,17 @@ int main(int argc, char** argv)
     {
         vector<string> specs = {
             "book:",
+            "cachedir:",
             "config|c:",
             "color",
             "cputime",
             "game|g:",
             "help|h",
+            "hugepages",
             "level|l:",
             "nobook",
             "noresign",
+            "numa",
             "quiet|q",
             "seed|r:",
             "showboard",
@@ -70,18 +74,21 @@ int main(int argc, char** argv)
             cout <<
                 "Usage: pentobi_gtp [options] [input files]\n"
                 "--book       load an external book file\n"
+                "--cachedir   cache move tables in a directory\n"
                 "--config,-c  set GTP config file\n"
                 "--color      colorize text output of boards\n"
                 "--cputime    use CPU time\n"
                 "--game,-g    game variant (classic, classic_2, classic_3,\n"
                 "             duo, trigon, trigon_2, trigon_3, junior)\n"
                 "--help,-h    print help message and exit\n"
+                "--hugepages  use huge pages for the search tree\n"
                 "--level,-l   set playing strength level\n"
                 "--seed,-r    set random seed\n"
                 "--showboard  automatically write board to stderr after\n"
                 "             changes\n"
                 "--nobook     disable opening book\n"
                 "--noresign   disable resign\n"
+                "--numa       pin threads and use NUMA-local memory\n"
                 "--quiet,-q   do not print logging messages\n"
                 "--threads    number of threads in the search\n"
                 "--version,-v print version and exit\n";
@@ -104,6 +111,7 @@ int main(int argc, char** argv)
                 throw runtime_error("Number of threads must be greater zero.");
         }
         Board::color_output = opt.contains("color");
+        BoardConst::set_cache_dir(opt.get("cachedir", ""));
         if (opt.contains("quiet"))
             libboardgame_base::disable_logging();
         if (opt.contains("seed"))
@@ -124,6 +132,10 @@ int main(int argc, char** argv)
             engine.set_show_board(true);
         if (opt.contains("cputime"))
             engine.use_cpu_time(true);
+        if (opt.contains("hugepages"))
+            engine.use_huge_pages(true);
+        if (opt.contains("numa"))
+            engine.use_numa(true);
         string book_file = opt.get("book", "");
         if (! book_file.empty())
         {
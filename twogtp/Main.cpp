@@ -5,15 +5,17 @@
 //-----------------------------------------------------------------------------
 
 #include <atomic>
-#include <thread>
 #include "Analyze.h"
 #include "TwoGtp.h"
 #include "libboardgame_base/Log.h"
 #include "libboardgame_base/Options.h"
+#include "libboardgame_base/ThreadPool.h"
 #include "libpentobi_base/Variant.h"
 
 using namespace std;
 using libboardgame_base::Options;
+using libboardgame_base::TaskGroup;
+using libboardgame_base::ThreadPool;
 using libpentobi_base::Variant;
 
 //-----------------------------------------------------------------------------
@@ -72,10 +74,13 @@ int main(int argc, char** argv)
             twogtp->set_save_interval(save_interval);
             twogtps.push_back(twogtp);
         }
-        vector<thread> threads;
-        threads.reserve(nu_threads);
+        // The game loops mostly wait for the engines, which run in their
+        // own processes, so they get their own pool with one worker per loop
+        // instead of using the global pool
+        ThreadPool pool(nu_threads);
+        TaskGroup group(pool);
         for (auto& i : twogtps)
-            threads.emplace_back([&i, &result]()
+            group.run([&i, &result]()
             {
                 try
                 {
@@ -87,8 +92,7 @@ int main(int argc, char** argv)
                     result = 1;
                 }
             });
-        for (auto& t : threads)
-            t.join();
+        group.wait();
     }
     catch (const exception& e)
     {